@@ -0,0 +1,27 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * DTEK-V Benchmarks
+ * Built with `make bench` and linked in place of src/main.c
+ */
+
+/* Iterations per measurement */
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS 1000
+#endif
+
+/* Keep a value alive so the compiler cannot drop the work producing it */
+#define BENCH_KEEP(x) asm volatile("" : : "r"(x) : "memory")
+
+/* Print "name: cycles per iteration" with one decimal */
+void bench_report(const char *name, unsigned int cycles, unsigned int iterations);
+
+/* Benchmark groups */
+void bench_convert(void);
+void bench_string(void);
+void bench_trap(void);
+void bench_gpio(void);
+void bench_suite(void);     /* Machine-readable report, see bench_suite.c */
+
+#endif /* BENCH_H */
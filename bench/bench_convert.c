@@ -0,0 +1,94 @@
+#include "bench.h"
+#include "convert.h"
+#include "utils.h"
+
+/* ===== Reference Implementations (previous library code) ===== */
+
+/* Descending-divisor loop formerly used by print_udec */
+static int ref_udec(unsigned int x, char *buf) {
+    unsigned int divisor = 1000000000;
+    int len = 0;
+    do {
+        unsigned int digit = x / divisor;
+        if (digit != 0 || len != 0)
+            buf[len++] = (char)('0' + digit);
+        x -= digit * divisor;
+        divisor /= 10;
+    } while (divisor != 0);
+    if (len == 0)
+        buf[len++] = '0';
+    buf[len] = '\0';
+    return len;
+}
+
+/* Divide-per-digit and reverse, formerly used by utoa */
+static int ref_utoa(unsigned int value, char *str, unsigned int base) {
+    char *ptr = str, *ptr1 = str;
+    int len = 0;
+    do {
+        unsigned int tmp = value;
+        value /= base;
+        *ptr++ = "0123456789abcdef"[tmp - value * base];
+        len++;
+    } while (value);
+    *ptr-- = '\0';
+    while (ptr1 < ptr) {
+        char c = *ptr;
+        *ptr-- = *ptr1;
+        *ptr1++ = c;
+    }
+    return len;
+}
+
+/* ===== Benchmarks ===== */
+
+#define NUM_VALUES 16
+
+static unsigned int values_small[NUM_VALUES];
+static unsigned int values_large[NUM_VALUES];
+static unsigned long long values_64[NUM_VALUES];
+
+static void make_values(void) {
+    unsigned int seed = 12345;
+    for (int i = 0; i < NUM_VALUES; i++) {
+        seed = seed * 1664525 + 1013904223;
+        values_small[i] = seed % 1000;
+        values_large[i] = seed | 0x80000000;
+        values_64[i] = ((unsigned long long)seed << 32) | (seed * 2654435761u);
+    }
+}
+
+#define BENCH_CONV(name, expr, values) \
+    do { \
+        char buf[CONV_BUF_SIZE]; \
+        unsigned int start = get_cycles(); \
+        for (unsigned int i = 0; i < BENCH_ITERATIONS; i++) { \
+            int len = expr(values[i % NUM_VALUES]); \
+            BENCH_KEEP(len); \
+        } \
+        bench_report(name, get_cycles() - start, BENCH_ITERATIONS); \
+    } while (0)
+
+#define REF_DEC(v)  ref_udec(v, buf)
+#define REF_UTOA(v) ref_utoa(v, buf, 10)
+#define REF_HEX(v)  ref_utoa(v, buf, 16)
+#define NEW_DEC(v)  u32_to_dec(v, buf)
+#define NEW_HEX(v)  u32_to_hex(v, buf, 0, 0)
+#define NEW_DEC64(v) u64_to_dec(v, buf)
+#define NEW_HEX64(v) u64_to_hex(v, buf, 0, 0)
+
+void bench_convert(void) {
+    make_values();
+
+    printf("\n--- Integer to text (cycles per conversion) ---\n");
+    BENCH_CONV("ref print_udec  0-999", REF_DEC, values_small);
+    BENCH_CONV("ref utoa        0-999", REF_UTOA, values_small);
+    BENCH_CONV("u32_to_dec      0-999", NEW_DEC, values_small);
+    BENCH_CONV("ref print_udec  10 digits", REF_DEC, values_large);
+    BENCH_CONV("ref utoa        10 digits", REF_UTOA, values_large);
+    BENCH_CONV("u32_to_dec      10 digits", NEW_DEC, values_large);
+    BENCH_CONV("ref utoa        hex", REF_HEX, values_large);
+    BENCH_CONV("u32_to_hex      hex", NEW_HEX, values_large);
+    BENCH_CONV("u64_to_dec      20 digits", NEW_DEC64, values_64);
+    BENCH_CONV("u64_to_hex      16 digits", NEW_HEX64, values_64);
+}
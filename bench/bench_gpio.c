@@ -0,0 +1,71 @@
+#include "bench.h"
+#include "devices.h"
+#include "utils.h"
+
+/*
+ * GPIO drive cost: per-pin calls against port and pin-group writes. Pins
+ * 0-7 of bank 0 are driven as outputs while this runs and are returned to
+ * inputs afterwards.
+ */
+
+#define BUS_PIN_MASK 0xFF
+
+/* Print the cost of one pin change and the rate it allows */
+static void report_rate(const char *name, unsigned int cycles, unsigned int changes) {
+    bench_report(name, cycles, changes);
+    unsigned int tenths = (cycles * 10 + changes / 2) / changes;
+    if (tenths)
+        printf("  %-28s %6u kHz\n", "  -> toggle rate", CPU_CLOCK_HZ / 100 / tenths);
+}
+
+/* Eight gpio_write calls, one per bit, the way a bus was driven before */
+static void bus_write_pins(unsigned int value) {
+    for (int bit = 0; bit < 8; bit++)
+        gpio_write(bit, (value >> bit) & 1);
+}
+
+void bench_gpio(void) {
+    static const unsigned char bus_pins[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    static const unsigned char split_pins[8] = {16, 17, 18, 19, 20, 21, 22, 23};
+    struct gpio_group bus, split;
+
+    printf("\n--- GPIO ---\n");
+
+    gpio_init();
+    gpio_port_set_direction(0, BUS_PIN_MASK, BUS_PIN_MASK);
+    gpio_group_init(&bus, bus_pins, 8);
+    gpio_group_init(&split, split_pins, 8);
+
+    unsigned int start = get_cycles();
+    for (unsigned int i = 0; i < BENCH_ITERATIONS; i++)
+        gpio_toggle(0);
+    report_rate("gpio_toggle", get_cycles() - start, BENCH_ITERATIONS);
+
+    start = get_cycles();
+    for (unsigned int i = 0; i < BENCH_ITERATIONS; i++)
+        gpio_port_toggle(0, 0x1);
+    report_rate("gpio_port_toggle", get_cycles() - start, BENCH_ITERATIONS);
+
+    start = get_cycles();
+    for (unsigned int i = 0; i < BENCH_ITERATIONS; i++)
+        bus_write_pins(i);
+    bench_report("8-bit bus, 8x gpio_write", get_cycles() - start, BENCH_ITERATIONS);
+
+    start = get_cycles();
+    for (unsigned int i = 0; i < BENCH_ITERATIONS; i++)
+        gpio_port_write(0, BUS_PIN_MASK, i);
+    bench_report("8-bit bus, gpio_port_write", get_cycles() - start, BENCH_ITERATIONS);
+
+    start = get_cycles();
+    for (unsigned int i = 0; i < BENCH_ITERATIONS; i++)
+        gpio_group_write(&bus, i);
+    bench_report("8-bit bus, group (1 run)", get_cycles() - start, BENCH_ITERATIONS);
+
+    /* Pins 16-23 straddle the banks; not driven, only the cost is measured */
+    start = get_cycles();
+    for (unsigned int i = 0; i < BENCH_ITERATIONS; i++)
+        BENCH_KEEP(gpio_group_read(&split));
+    bench_report("8-bit bus read, 2 banks", get_cycles() - start, BENCH_ITERATIONS);
+
+    gpio_port_set_direction(0, BUS_PIN_MASK, 0);
+}
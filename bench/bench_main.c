@@ -0,0 +1,24 @@
+#include "bench.h"
+#include "dtekv-lib.h"
+#include "utils.h"
+
+void bench_report(const char *name, unsigned int cycles, unsigned int iterations) {
+    unsigned int tenths = (cycles * 10 + iterations / 2) / iterations;
+    printf("  %-28s %6u.%u cycles\n", name, tenths / 10, tenths % 10);
+}
+
+int main(void) {
+    printf("\n=== DTEK-V Benchmarks (%u iterations) ===\n", BENCH_ITERATIONS);
+
+    bench_convert();
+    bench_string();
+#ifndef DTEKV_HOST
+    bench_trap();       /* ecall and timer interrupt entry need the target */
+#endif
+    bench_gpio();
+    bench_suite();
+
+    printf("\n=== Done ===\n");
+    uart_flush();
+    return 0;
+}
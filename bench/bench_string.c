@@ -0,0 +1,82 @@
+#include "bench.h"
+#include "strmem.h"
+#include "utils.h"
+
+/* ===== Reference Implementations (byte loops) ===== */
+
+static void ref_memcpy(char *d, const char *s, int n) {
+    while (n--)
+        *d++ = *s++;
+}
+
+static void ref_memset(char *d, char c, int n) {
+    while (n--)
+        *d++ = c;
+}
+
+static int ref_strlen(const char *s) {
+    int len = 0;
+    while (s[len] != '\0')
+        len++;
+    return len;
+}
+
+static int ref_strcmp(const char *s1, const char *s2) {
+    while (*s1 && (*s1 == *s2)) {
+        s1++;
+        s2++;
+    }
+    return *(unsigned char *)s1 - *(unsigned char *)s2;
+}
+
+/* ===== Benchmarks ===== */
+
+#define BUF_SIZE 1028
+
+static char src_buf[BUF_SIZE] __attribute__((aligned(4)));
+static char dst_buf[BUF_SIZE] __attribute__((aligned(4)));
+static char str_a[BUF_SIZE] __attribute__((aligned(4)));
+static char str_b[BUF_SIZE] __attribute__((aligned(4)));
+
+static const int sizes[] = {4, 16, 64, 256, 1024};
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+#define BENCH_RUN(label, n, stmt) \
+    do { \
+        char name[40]; \
+        snprintf(name, sizeof(name), "%-14s %5d B", label, n); \
+        unsigned int start = get_cycles(); \
+        for (unsigned int i = 0; i < BENCH_ITERATIONS; i++) { \
+            stmt; \
+        } \
+        bench_report(name, get_cycles() - start, BENCH_ITERATIONS); \
+    } while (0)
+
+void bench_string(void) {
+    for (int i = 0; i < BUF_SIZE; i++) {
+        src_buf[i] = (char)i;
+    }
+
+    printf("\n--- Memory and strings (cycles per call) ---\n");
+    for (unsigned int k = 0; k < NUM_SIZES; k++) {
+        int n = sizes[k];
+
+        /* Strings of length n, equal up to the terminator */
+        memset(str_a, 'x', n);
+        memset(str_b, 'x', n);
+        str_a[n] = '\0';
+        str_b[n] = '\0';
+
+        BENCH_RUN("ref memcpy", n, ref_memcpy(dst_buf, src_buf, n));
+        BENCH_RUN("memcpy", n, memcpy(dst_buf, src_buf, n));
+        BENCH_RUN("memcpy +1/+3", n, memcpy(dst_buf + 1, src_buf + 3, n));
+        BENCH_RUN("ref memset", n, ref_memset(dst_buf, 0, n));
+        BENCH_RUN("memset", n, memset(dst_buf, 0, n));
+        BENCH_RUN("memmove", n, memmove(dst_buf + 4, dst_buf, n));
+        BENCH_RUN("memcmp", n, BENCH_KEEP(memcmp(str_a, str_b, n)));
+        BENCH_RUN("ref strlen", n, BENCH_KEEP(ref_strlen(str_a)));
+        BENCH_RUN("strlen", n, BENCH_KEEP(strlen(str_a)));
+        BENCH_RUN("ref strcmp", n, BENCH_KEEP(ref_strcmp(str_a, str_b)));
+        BENCH_RUN("strcmp", n, BENCH_KEEP(strcmp(str_a, str_b)));
+    }
+}
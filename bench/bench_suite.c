@@ -0,0 +1,299 @@
+#include "bench.h"
+#include "dtekv-lib.h"
+#include "devices.h"
+#include "strmem.h"
+#include "delay.h"
+#include "irq.h"
+#include "csr.h"
+#include "utils.h"
+
+/*
+ * Kernel suite with a machine-readable report. Every kernel call is timed
+ * on its own with mcycle and minstret, the cost of an empty call is
+ * subtracted, and the per-call samples are reduced to min/median/max
+ * cycles and the CPI over all calls. One line per kernel:
+ *
+ *   @bench name=memcpy_256 n=1000 min=70 median=70 max=75 cpi=1.09
+ *
+ * framed by @bench-begin/@bench-end lines, so scripts/bench_compare.py
+ * can pick the report out of a capture and diff it against a baseline.
+ */
+
+#define SUITE_VERSION     1
+#define OVERHEAD_RUNS     16
+#define ROUND_TRIP_PERIOD 2000      /* Timer one-shot length in cycles */
+#define ROUND_TRIP_LIMIT  100000    /* Give up on a lost interrupt */
+
+struct bench_kernel {
+    const char *name;               /* No spaces; the key in the report */
+    void (*run)(void);              /* One operation */
+    void (*setup)(void);            /* Optional, before the first call */
+    void (*teardown)(void);         /* Optional, after the last call */
+    unsigned int nominal;           /* Intended cycles, subtracted in the report */
+};
+
+static unsigned int samples[BENCH_ITERATIONS];
+static unsigned int seq;            /* Varies the kernels' inputs */
+
+/* ===== Kernels ===== */
+
+static char src_buf[256] __attribute__((aligned(4)));
+static char dst_buf[256] __attribute__((aligned(4)));
+static char str_a[65], str_b[65];
+
+static void k_empty(void) {
+}
+
+/*
+ * Output goes to the UART buffer as usual, but bytes it has no room for
+ * are dropped so the link speed does not set the result. What gets
+ * through is one comment line in the capture.
+ */
+static void uart_drop_setup(void) {
+    print("# ");
+    uart_flush();
+    uart_set_tx_policy(UART_TX_DROP);
+}
+
+static void uart_drop_teardown(void) {
+    uart_flush();
+    uart_set_tx_policy(UART_TX_BLOCK);
+    printc('\n');
+    uart_flush();
+}
+
+static void k_printf(void) {
+    printf("%5d %08x %s|", seq, seq * 2654435761u, "abc");
+    seq++;
+}
+
+static void k_print_udec(void) {
+    print_udec(seq++ * 2654435761u);
+}
+
+static void k_snprintf(void) {
+    char buf[32];
+    BENCH_KEEP(snprintf(buf, sizeof(buf), "%5d %08x %s|", seq, seq * 2654435761u, "abc"));
+    seq++;
+}
+
+static void strings_setup(void) {
+    for (int i = 0; i < (int)sizeof(src_buf); i++)
+        src_buf[i] = (char)i;
+    memset(str_a, 'x', 64);
+    memset(str_b, 'x', 64);
+    str_a[64] = str_b[64] = '\0';
+}
+
+static void k_memcpy(void) {
+    memcpy(dst_buf, src_buf, sizeof(dst_buf));
+}
+
+static void k_memset(void) {
+    memset(dst_buf, 0, sizeof(dst_buf));
+}
+
+static void k_strlen(void) {
+    BENCH_KEEP(strlen(str_a));
+}
+
+static void k_strcmp(void) {
+    BENCH_KEEP(strcmp(str_a, str_b));
+}
+
+static void k_display_decimal(void) {
+    display_decimal(seq++ % 1000000);
+}
+
+static void k_display_hex(void) {
+    display_hex(seq++ * 2654435761u);
+}
+
+static void k_display_string(void) {
+    display_string((seq++ & 1) ? "HELLO" : "DTEK-V");
+}
+
+static void gpio_setup(void) {
+    gpio_init();
+    gpio_port_set_direction(0, 0x1, 0x1);
+}
+
+static void gpio_teardown(void) {
+    gpio_port_set_direction(0, 0x1, 0);
+}
+
+static void k_gpio_toggle(void) {
+    gpio_toggle(0);
+}
+
+static void k_gpio_port_toggle(void) {
+    gpio_port_toggle(0, 0x1);
+}
+
+/*
+ * Interrupt round trip: arm a timer one-shot and wait until the ISR has
+ * run and control is back here. The period is the nominal part; the rest
+ * is arming, entry, dispatch, the ISR and the return.
+ */
+static volatile int round_trip_done;
+static void (*saved_timer_isr)(void);
+
+static void round_trip_isr(void) {
+    round_trip_done = 1;
+}
+
+static void round_trip_setup(void) {
+    saved_timer_isr = timer_isr;
+    timer_isr = round_trip_isr;
+    irq_enable(IRQ_TIMER);
+    csr_set(mstatus, MSTATUS_MIE);
+}
+
+static void round_trip_teardown(void) {
+    irq_disable(IRQ_TIMER);
+    mmio_write16(TIMER_CONTROL, TIMER_CTRL_STOP);
+    timer_isr = saved_timer_isr;
+}
+
+static void k_irq_round_trip(void) {
+    round_trip_done = 0;
+    mmio_write16(TIMER_CONTROL, TIMER_CTRL_STOP);
+    mmio_write16(TIMER_PERIODL, (ROUND_TRIP_PERIOD - 1) & 0xFFFF);
+    mmio_write16(TIMER_PERIODH, (ROUND_TRIP_PERIOD - 1) >> 16);
+    mmio_write16(TIMER_CONTROL, TIMER_CTRL_ITO | TIMER_CTRL_START);
+
+    unsigned int start = csr_read(mcycle);
+    while (!round_trip_done && csr_read(mcycle) - start < ROUND_TRIP_LIMIT)
+        ;
+}
+
+#ifndef DTEKV_HOST
+static void k_ecall_round_trip(void) {
+    register unsigned int a7 asm("a7") = 0;     /* Unknown syscall: decode and return */
+    asm volatile("ecall" : : "r"(a7) : "memory");
+}
+#endif
+
+static void k_delay_cycles(void) {
+    delay_cycles(1000);
+}
+
+static void k_delay_us(void) {
+    delay_us(100);
+}
+
+static const struct bench_kernel kernels[] = {
+    { "printf",            k_printf,           uart_drop_setup, uart_drop_teardown, 0 },
+    { "print_udec",        k_print_udec,       uart_drop_setup, uart_drop_teardown, 0 },
+    { "snprintf",          k_snprintf,         0, 0, 0 },
+    { "memcpy_256",        k_memcpy,           strings_setup, 0, 0 },
+    { "memset_256",        k_memset,           strings_setup, 0, 0 },
+    { "strlen_64",         k_strlen,           strings_setup, 0, 0 },
+    { "strcmp_64",         k_strcmp,           strings_setup, 0, 0 },
+    { "display_decimal",   k_display_decimal,  display_init, 0, 0 },
+    { "display_hex",       k_display_hex,      display_init, 0, 0 },
+    { "display_string",    k_display_string,   display_init, 0, 0 },
+    { "gpio_toggle",       k_gpio_toggle,      gpio_setup, gpio_teardown, 0 },
+    { "gpio_port_toggle",  k_gpio_port_toggle, gpio_setup, gpio_teardown, 0 },
+    { "irq_round_trip",    k_irq_round_trip,   round_trip_setup, round_trip_teardown,
+      ROUND_TRIP_PERIOD },
+#ifndef DTEKV_HOST
+    { "ecall_round_trip",  k_ecall_round_trip, 0, 0, 0 },
+#endif
+    { "delay_cycles_1000", k_delay_cycles,     0, 0, 1000 },
+    { "delay_us_100",      k_delay_us,         0, 0, CPU_CLOCK_HZ / 10000 },
+};
+
+#define NUM_KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+/* ===== Runner ===== */
+
+static unsigned int overhead_cycles, overhead_instret;
+
+/* Cycles and instructions of one call, including the measurement itself */
+static inline void time_call(void (*fn)(void), unsigned int *cycles, unsigned int *instret) {
+    unsigned int c0 = csr_read(mcycle);
+    unsigned int i0 = csr_read(minstret);
+    fn();
+    unsigned int i1 = csr_read(minstret);
+    unsigned int c1 = csr_read(mcycle);
+    *cycles = c1 - c0;
+    *instret = i1 - i0;
+}
+
+/* Cost of timing an empty kernel; the minimum filters out interrupts */
+static void measure_overhead(void) {
+    overhead_cycles = ~0u;
+    overhead_instret = ~0u;
+    for (int i = 0; i < OVERHEAD_RUNS; i++) {
+        unsigned int c, n;
+        time_call(k_empty, &c, &n);
+        if (c < overhead_cycles)
+            overhead_cycles = c;
+        if (n < overhead_instret)
+            overhead_instret = n;
+    }
+}
+
+/* Shell sort with gaps 3h+1 */
+static void sort(unsigned int *a, unsigned int n) {
+    unsigned int gap = 1;
+    while (gap < n / 3)
+        gap = gap * 3 + 1;
+    for (; gap > 0; gap /= 3) {
+        for (unsigned int i = gap; i < n; i++) {
+            unsigned int v = a[i];
+            unsigned int j = i;
+            for (; j >= gap && a[j - gap] > v; j -= gap)
+                a[j] = a[j - gap];
+            a[j] = v;
+        }
+    }
+}
+
+static void run_kernel(const struct bench_kernel *k) {
+    unsigned int total_cycles = 0, total_instret = 0;
+
+    if (k->setup)
+        k->setup();
+    for (unsigned int i = 0; i < BENCH_ITERATIONS; i++) {
+        unsigned int c, n;
+        time_call(k->run, &c, &n);
+        c = c > overhead_cycles ? c - overhead_cycles : 0;
+        n = n > overhead_instret ? n - overhead_instret : 0;
+        samples[i] = c;
+        total_cycles += c;
+        total_instret += n;
+    }
+    if (k->teardown)
+        k->teardown();
+
+    sort(samples, BENCH_ITERATIONS);
+    int nominal = k->nominal;
+    unsigned int median = samples[BENCH_ITERATIONS / 2];
+
+    /* CPI in hundredths without 64-bit division */
+    unsigned int cpi = 0;
+    if (total_instret) {
+        cpi = total_cycles / total_instret * 100 +
+              total_cycles % total_instret * 100 / total_instret;
+    }
+
+    printf("@bench name=%s n=%u min=%d median=%d max=%d cpi=%u.%02u",
+           k->name, BENCH_ITERATIONS, (int)samples[0] - nominal, (int)median - nominal,
+           (int)samples[BENCH_ITERATIONS - 1] - nominal, cpi / 100, cpi % 100);
+    if (nominal)
+        printf(" nominal=%d", nominal);
+    printf("\n");
+}
+
+void bench_suite(void) {
+    printf("\n--- Kernel suite (cycles per call) ---\n");
+    measure_overhead();
+    printf("@bench-begin version=%d clock=%u overhead=%u\n",
+           SUITE_VERSION, CPU_CLOCK_HZ, overhead_cycles);
+    for (unsigned int i = 0; i < NUM_KERNELS; i++)
+        run_kernel(&kernels[i]);
+    printf("@bench-end\n");
+    uart_flush();
+}
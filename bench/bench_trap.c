@@ -0,0 +1,75 @@
+#include "bench.h"
+#include "dtekv-lib.h"
+#include "devices.h"
+#include "irq.h"
+#include "csr.h"
+#include "utils.h"
+
+/*
+ * Trap entry/exit cost. Build once normally and once with
+ * `make bench TRAP_FULL_SAVE=1` to compare the lean vectored path with
+ * the original save-everything routine.
+ */
+
+#define LATENCY_SAMPLES  64
+#define LATENCY_PERIOD   2000   /* Timer one-shot length in cycles */
+
+static volatile unsigned int irq_stamp;
+
+static void stamp_isr(void) {
+    irq_stamp = get_cycles();
+}
+
+/* ecall with an unknown syscall number: enter, decode, return */
+static inline void null_ecall(void) {
+    register unsigned int a7 asm("a7") = 0;
+    asm volatile("ecall" : : "r"(a7) : "memory");
+}
+
+void bench_trap(void) {
+#ifdef TRAP_FULL_SAVE
+    printf("\n--- Trap path: full save, direct mtvec ---\n");
+#else
+    printf("\n--- Trap path: caller-saved only, vectored mtvec ---\n");
+#endif
+
+    unsigned int start = get_cycles();
+    for (unsigned int i = 0; i < BENCH_ITERATIONS; i++)
+        null_ecall();
+    bench_report("ecall round trip", get_cycles() - start, BENCH_ITERATIONS);
+
+    /*
+     * Interrupt latency: arm a one-shot of LATENCY_PERIOD cycles and time
+     * from its expiry to the first instruction of the user timer ISR. A
+     * period register of P counts P + 1 cycles, as in bench_suite.c.
+     */
+    void (*saved_isr)(void) = timer_isr;
+    timer_isr = stamp_isr;
+    irq_enable(IRQ_TIMER);
+    csr_set(mstatus, MSTATUS_MIE);
+
+    unsigned int min = ~0u, max = 0, total = 0;
+    for (int i = 0; i < LATENCY_SAMPLES; i++) {
+        irq_stamp = 0;
+        mmio_write16(TIMER_CONTROL, TIMER_CTRL_STOP);
+        mmio_write16(TIMER_PERIODL, (LATENCY_PERIOD - 1) & 0xFFFF);
+        mmio_write16(TIMER_PERIODH, (LATENCY_PERIOD - 1) >> 16);
+        unsigned int armed = get_cycles();
+        mmio_write16(TIMER_CONTROL, TIMER_CTRL_ITO | TIMER_CTRL_START);
+        while (irq_stamp == 0)
+            ;
+        unsigned int latency = irq_stamp - armed - LATENCY_PERIOD;
+        total += latency;
+        if (latency < min)
+            min = latency;
+        if (latency > max)
+            max = latency;
+    }
+
+    irq_disable(IRQ_TIMER);
+    mmio_write16(TIMER_CONTROL, TIMER_CTRL_STOP);
+    timer_isr = saved_isr;
+
+    bench_report("timer IRQ to handler (avg)", total, LATENCY_SAMPLES);
+    printf("  %-28s %6u / %u cycles\n", "timer IRQ min / max", min, max);
+}
@@ -0,0 +1,557 @@
+#include "sim.h"
+#include "csr.h"
+#include "mmio.h"
+#include "devices.h"
+#include "dtekv-lib.h"
+#include "delay.h"
+#include "irq.h"
+#include "sched.h"
+#include "crash.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef CPU_CLOCK_HZ
+#define CPU_CLOCK_HZ 30000000
+#endif
+
+#define MCAUSE_INTERRUPT 0x80000000u
+
+/* ===== Clock ===== */
+
+static unsigned long long epoch_ns;
+static unsigned long long cycle_bias;       /* From writes to mcycle */
+static unsigned long long instret_bias;
+
+static unsigned long long host_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Host time since start-up in CPU cycles, split to avoid overflow */
+static unsigned long long sim_now(void) {
+    unsigned long long ns = host_ns() - epoch_ns;
+    return ns / 1000000000ULL * CPU_CLOCK_HZ +
+           ns % 1000000000ULL * CPU_CLOCK_HZ / 1000000000ULL;
+}
+
+unsigned long long sim_cycles(void) {
+    return sim_now() + cycle_bias;
+}
+
+/* ===== Device State ===== */
+
+static struct {
+    unsigned int status;                    /* TO, RUN */
+    unsigned int control;                   /* ITO, CONT */
+    unsigned int period;
+    unsigned int snap;
+    unsigned long long count;               /* Cycles to the next timeout at mark */
+    unsigned long long mark;
+} timer;
+
+static struct {
+    unsigned char tx[SIM_UART_FIFO], rx[SIM_UART_FIFO];
+    unsigned int tx_head, tx_count;
+    unsigned int rx_head, rx_count;
+    unsigned int ctrl;                      /* RE, WE */
+    unsigned int drain;                     /* Cycles per byte, 0 = instant */
+    unsigned long long drain_mark;
+    char out[4096];                         /* Pending host output */
+    unsigned int out_len;
+    char *capture;                          /* Output taken by sim_uart_capture() */
+    unsigned int capture_size, capture_len;
+} uart;
+
+struct sim_pio {
+    unsigned int data;
+    unsigned int irq_mask;
+    unsigned int edge;
+};
+
+static struct sim_pio switches, button;
+static unsigned int leds;
+static unsigned int displays[DISPLAY_COUNT];
+static unsigned int gpio_out[GPIO_BANK_COUNT], gpio_dir[GPIO_BANK_COUNT];
+static unsigned int gpio_in[GPIO_BANK_COUNT];
+
+static unsigned int csr[SIM_CSR_COUNT];
+
+/* ===== Timer ===== */
+
+/* Advance the counter; a period of P counts P + 1 cycles like the board */
+static void timer_update(unsigned long long now) {
+    if (!(timer.status & TIMER_STATUS_RUN))
+        return;
+
+    unsigned long long elapsed = now - timer.mark;
+    unsigned long long cycle = (unsigned long long)timer.period + 1;
+    timer.mark = now;
+
+    if (elapsed < timer.count) {
+        timer.count -= elapsed;
+        return;
+    }
+    timer.status |= TIMER_STATUS_TO;
+    if (timer.control & TIMER_CTRL_CONT) {
+        timer.count = cycle - (elapsed - timer.count) % cycle;
+    } else {
+        timer.status &= ~TIMER_STATUS_RUN;
+        timer.count = cycle;
+    }
+}
+
+static void timer_write(unsigned int offset, unsigned int value) {
+    switch (offset) {
+    case 0x00:
+        timer.status &= ~TIMER_STATUS_TO;   /* Any write clears TO */
+        break;
+    case 0x04:
+        timer.control = value & (TIMER_CTRL_ITO | TIMER_CTRL_CONT);
+        if (value & TIMER_CTRL_STOP) {
+            timer.status &= ~TIMER_STATUS_RUN;
+        } else if ((value & TIMER_CTRL_START) && !(timer.status & TIMER_STATUS_RUN)) {
+            timer.status |= TIMER_STATUS_RUN;
+            timer.mark = sim_now();
+        }
+        break;
+    case 0x08:
+    case 0x0C:
+        /* Writing a period register stops the timer and reloads it */
+        if (offset == 0x08)
+            timer.period = (timer.period & 0xFFFF0000) | value;
+        else
+            timer.period = (timer.period & 0xFFFF) | (value << 16);
+        timer.status &= ~TIMER_STATUS_RUN;
+        timer.count = (unsigned long long)timer.period + 1;
+        break;
+    case 0x10:
+    case 0x14:
+        timer.snap = timer.count - 1;       /* Any write takes a snapshot */
+        break;
+    }
+}
+
+static unsigned int timer_read(unsigned int offset) {
+    switch (offset) {
+    case 0x00: return timer.status;
+    case 0x04: return timer.control;
+    case 0x08: return timer.period & 0xFFFF;
+    case 0x0C: return timer.period >> 16;
+    case 0x10: return timer.snap & 0xFFFF;
+    case 0x14: return timer.snap >> 16;
+    }
+    return 0;
+}
+
+/* ===== JTAG UART ===== */
+
+static void uart_out_flush(void) {
+    unsigned int done = 0;
+    while (done < uart.out_len) {
+        ssize_t n = write(STDOUT_FILENO, uart.out + done, uart.out_len - done);
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    uart.out_len = 0;
+}
+
+static void uart_out(unsigned char c) {
+    if (uart.capture) {
+        if (uart.capture_len < uart.capture_size)
+            uart.capture[uart.capture_len] = c;
+        uart.capture_len++;
+        return;
+    }
+    uart.out[uart.out_len++] = c;
+    if (c == '\n' || uart.out_len == sizeof(uart.out))
+        uart_out_flush();
+}
+
+static void uart_update(unsigned long long now) {
+    if (uart.tx_count == 0 || uart.drain == 0) {
+        uart.drain_mark = now;
+        return;
+    }
+    unsigned long long n = (now - uart.drain_mark) / uart.drain;
+    if (n > uart.tx_count)
+        n = uart.tx_count;
+    uart.drain_mark += n * uart.drain;
+    while (n--) {
+        uart_out(uart.tx[uart.tx_head]);
+        uart.tx_head = (uart.tx_head + 1) % SIM_UART_FIFO;
+        uart.tx_count--;
+    }
+}
+
+static unsigned int uart_ctrl_read(void) {
+    unsigned int space = SIM_UART_FIFO - uart.tx_count;
+    unsigned int value = uart.ctrl | (space << 16);
+    if ((uart.ctrl & JTAG_UART_CTRL_RE) && uart.rx_count)
+        value |= JTAG_UART_CTRL_RI;
+    if ((uart.ctrl & JTAG_UART_CTRL_WE) && space >= SIM_UART_WI_MIN)
+        value |= JTAG_UART_CTRL_WI;
+    return value;
+}
+
+static unsigned int uart_data_read(void) {
+    if (uart.rx_count == 0)
+        return 0;
+    unsigned int c = uart.rx[uart.rx_head];
+    uart.rx_head = (uart.rx_head + 1) % SIM_UART_FIFO;
+    uart.rx_count--;
+    return c | JTAG_UART_RVALID_MASK | (uart.rx_count << 16);
+}
+
+static void uart_data_write(unsigned int value) {
+    if (uart.drain == 0) {
+        uart_out(value & JTAG_UART_DATA_MASK);
+        return;
+    }
+    if (uart.tx_count == SIM_UART_FIFO)
+        return;                             /* Dropped, as by the hardware */
+    uart.tx[(uart.tx_head + uart.tx_count) % SIM_UART_FIFO] = value & JTAG_UART_DATA_MASK;
+    uart.tx_count++;
+}
+
+void sim_uart_set_drain(unsigned int cycles_per_byte) {
+    uart_update(sim_now());
+    uart.drain = cycles_per_byte;
+    uart.drain_mark = sim_now();
+    if (cycles_per_byte == 0) {
+        while (uart.tx_count) {
+            uart_out(uart.tx[uart.tx_head]);
+            uart.tx_head = (uart.tx_head + 1) % SIM_UART_FIFO;
+            uart.tx_count--;
+        }
+    }
+}
+
+unsigned int sim_uart_input(const char *buf, unsigned int n) {
+    unsigned int i;
+    for (i = 0; i < n && uart.rx_count < SIM_UART_FIFO; i++) {
+        uart.rx[(uart.rx_head + uart.rx_count) % SIM_UART_FIFO] = buf[i];
+        uart.rx_count++;
+    }
+    sim_poll();
+    return i;
+}
+
+unsigned int sim_uart_tx_level(void) {
+    uart_update(sim_now());
+    return uart.tx_count;
+}
+
+void sim_uart_capture(char *buf, unsigned int size) {
+    uart_update(sim_now());
+    uart_out_flush();
+    uart.capture = buf;
+    uart.capture_size = size;
+    uart.capture_len = 0;
+}
+
+unsigned int sim_uart_captured(void) {
+    uart_update(sim_now());
+    return uart.capture_len;
+}
+
+/* ===== Switches, Buttons, GPIO ===== */
+
+static unsigned int pio_read(struct sim_pio *p, unsigned int offset) {
+    switch (offset) {
+    case 0x00: return p->data;
+    case 0x08: return p->irq_mask;
+    case 0x0C: return p->edge;
+    }
+    return 0;
+}
+
+static void pio_write(struct sim_pio *p, unsigned int offset, unsigned int value) {
+    if (offset == 0x08)
+        p->irq_mask = value;
+    else if (offset == 0x0C)
+        p->edge &= ~value;                  /* Writing 1s clears captured edges */
+}
+
+void sim_switch_set(unsigned int value) {
+    value &= 0x3FF;
+    switches.edge |= switches.data ^ value;
+    switches.data = value;
+    sim_poll();
+}
+
+void sim_button_set(unsigned int value) {
+    value &= 0x1;
+    button.edge |= value & ~button.data;
+    button.data = value;
+    sim_poll();
+}
+
+void sim_gpio_set_input(int bank, unsigned int mask, unsigned int value) {
+    if (bank < 0 || bank >= GPIO_BANK_COUNT)
+        return;
+    gpio_in[bank] = ((gpio_in[bank] & ~mask) | (value & mask)) & GPIO_BANK_MASK;
+}
+
+unsigned int sim_gpio_output(int bank) {
+    if (bank < 0 || bank >= GPIO_BANK_COUNT)
+        return 0;
+    return gpio_out[bank] & gpio_dir[bank];
+}
+
+unsigned int sim_gpio_direction(int bank) {
+    if (bank < 0 || bank >= GPIO_BANK_COUNT)
+        return 0;
+    return gpio_dir[bank];
+}
+
+unsigned int sim_led_read(void) {
+    return leds;
+}
+
+unsigned int sim_display_read(int n) {
+    if (n < 0 || n >= DISPLAY_COUNT)
+        return 0;
+    return displays[n];
+}
+
+/* ===== Interrupts ===== */
+
+static unsigned int sim_pending(void) {
+    unsigned int lines = 0;
+    if ((timer.status & TIMER_STATUS_TO) && (timer.control & TIMER_CTRL_ITO))
+        lines |= 1u << IRQ_TIMER;
+    if (switches.edge & switches.irq_mask)
+        lines |= 1u << IRQ_SWITCHES;
+    if (button.edge & button.irq_mask)
+        lines |= 1u << IRQ_BUTTON;
+    if (uart_ctrl_read() & (JTAG_UART_CTRL_RI | JTAG_UART_CTRL_WI))
+        lines |= 1u << IRQ_JTAG_UART;
+    return lines;
+}
+
+static void sim_update(void) {
+    if ((timer.status & TIMER_STATUS_RUN) || uart.tx_count) {
+        unsigned long long now = sim_now();
+        timer_update(now);
+        uart_update(now);
+    }
+}
+
+/* Trap entry, the vectored handler's work and mret */
+static void sim_trap(unsigned int cause) {
+    unsigned int status = csr[SIM_CSR_mstatus];
+
+    csr[SIM_CSR_mstatus] = (status & ~(MSTATUS_MIE | MSTATUS_MPIE)) |
+                           ((status & MSTATUS_MIE) ? MSTATUS_MPIE : 0);
+    csr[SIM_CSR_mcause] = MCAUSE_INTERRUPT | cause;
+    csr[SIM_CSR_mepc] = 0;
+
+    irq_dispatch(cause);
+    sched_irq_exit();
+
+    status = csr[SIM_CSR_mstatus];
+    csr[SIM_CSR_mstatus] = (status & ~MSTATUS_MIE) | MSTATUS_MPIE |
+                           ((status & MSTATUS_MPIE) ? MSTATUS_MIE : 0);
+}
+
+void sim_poll(void) {
+    sim_update();
+    if (!(csr[SIM_CSR_mstatus] & MSTATUS_MIE))
+        return;
+
+    unsigned int ready = sim_pending() & csr[SIM_CSR_mie];
+    if (ready)
+        sim_trap(__builtin_ctz(ready));
+}
+
+/* ===== CSR Access ===== */
+
+/* Replace one 32-bit half of a 64-bit counter */
+static void counter_write(unsigned long long *bias, int high, unsigned int value) {
+    unsigned long long now = sim_now() + *bias;
+    unsigned long long next = high ? (now & 0xFFFFFFFFULL) | ((unsigned long long)value << 32)
+                                   : (now & ~0xFFFFFFFFULL) | value;
+    *bias += next - now;
+}
+
+static unsigned int csr_get(int n) {
+    switch (n) {
+    case SIM_CSR_mcycle:    return (unsigned int)sim_cycles();
+    case SIM_CSR_mcycleh:   return (unsigned int)(sim_cycles() >> 32);
+    /* No instruction count on the host; it runs at one cycle per instruction */
+    case SIM_CSR_minstret:  return (unsigned int)(sim_now() + instret_bias);
+    case SIM_CSR_minstreth: return (unsigned int)((sim_now() + instret_bias) >> 32);
+    case SIM_CSR_mip:       return sim_pending();
+    }
+    return csr[n];
+}
+
+static void csr_put(int n, unsigned int value) {
+    switch (n) {
+    case SIM_CSR_mcycle:    counter_write(&cycle_bias, 0, value); break;
+    case SIM_CSR_mcycleh:   counter_write(&cycle_bias, 1, value); break;
+    case SIM_CSR_minstret:  counter_write(&instret_bias, 0, value); break;
+    case SIM_CSR_minstreth: counter_write(&instret_bias, 1, value); break;
+    case SIM_CSR_mip:       break;                  /* Driven by the devices */
+    default:                csr[n] = value; break;
+    }
+}
+
+/* Each access is one instruction; interrupts are taken before it and after a write */
+unsigned int sim_csr_read(int n) {
+    sim_poll();
+    return csr_get(n);
+}
+
+void sim_csr_write(int n, unsigned int value) {
+    sim_poll();
+    csr_put(n, value);
+    sim_poll();
+}
+
+unsigned int sim_csr_modify(int n, unsigned int set, unsigned int clear) {
+    sim_poll();
+    unsigned int old = csr_get(n);
+    csr_put(n, (old | set) & ~clear);
+    sim_poll();
+    return old;
+}
+
+/* ===== Register Access ===== */
+
+static void sim_unmapped(const char *op, unsigned int addr) {
+    static int warned;
+    char msg[48] = "sim: unmapped ";
+    int len = 14;
+
+    if (warned)
+        return;
+    warned = 1;
+    while (*op)
+        msg[len++] = *op++;
+    msg[len++] = ' ';
+    msg[len++] = '0';
+    msg[len++] = 'x';
+    for (int shift = 28; shift >= 0; shift -= 4)
+        msg[len++] = "0123456789abcdef"[(addr >> shift) & 0xF];
+    msg[len++] = '\n';
+    if (write(STDERR_FILENO, msg, len) < 0)
+        return;
+}
+
+static unsigned int sim_read(unsigned int addr) {
+    if (addr == LED_BASE)
+        return leds;
+    if (addr >= SWITCHES_BASE && addr < SWITCHES_BASE + 0x10)
+        return pio_read(&switches, addr - SWITCHES_BASE);
+    if (addr >= BUTTON_BASE && addr < BUTTON_BASE + 0x10)
+        return pio_read(&button, addr - BUTTON_BASE);
+    if (addr >= TIMER_BASE && addr < TIMER_BASE + 0x18)
+        return timer_read(addr - TIMER_BASE);
+    if (addr == JTAG_UART_DATA)
+        return uart_data_read();
+    if (addr == JTAG_UART_CTRL)
+        return uart_ctrl_read();
+    if (addr >= DISP_BASE && addr < DISP_DATA(DISPLAY_COUNT))
+        return displays[(addr - DISP_BASE) / DISP_STRIDE];
+    for (int bank = 0; bank < GPIO_BANK_COUNT; bank++) {
+        if (addr == GPIO_DATA(bank))
+            return (gpio_out[bank] & gpio_dir[bank]) | (gpio_in[bank] & ~gpio_dir[bank]);
+        if (addr == GPIO_DIR(bank))
+            return gpio_dir[bank];
+    }
+    sim_unmapped("read", addr);
+    return 0;
+}
+
+static void sim_write(unsigned int addr, unsigned int value) {
+    if (addr == LED_BASE) {
+        leds = value;
+    } else if (addr >= SWITCHES_BASE && addr < SWITCHES_BASE + 0x10) {
+        pio_write(&switches, addr - SWITCHES_BASE, value);
+    } else if (addr >= BUTTON_BASE && addr < BUTTON_BASE + 0x10) {
+        pio_write(&button, addr - BUTTON_BASE, value);
+    } else if (addr >= TIMER_BASE && addr < TIMER_BASE + 0x18) {
+        timer_write(addr - TIMER_BASE, value & 0xFFFF);
+    } else if (addr == JTAG_UART_DATA) {
+        uart_data_write(value);
+    } else if (addr == JTAG_UART_CTRL) {
+        uart.ctrl = value & (JTAG_UART_CTRL_RE | JTAG_UART_CTRL_WE);
+    } else if (addr >= DISP_BASE && addr < DISP_DATA(DISPLAY_COUNT)) {
+        displays[(addr - DISP_BASE) / DISP_STRIDE] = value;
+    } else {
+        for (int bank = 0; bank < GPIO_BANK_COUNT; bank++) {
+            if (addr == GPIO_DATA(bank)) {
+                gpio_out[bank] = value & GPIO_BANK_MASK;
+                return;
+            }
+            if (addr == GPIO_DIR(bank)) {
+                gpio_dir[bank] = value & GPIO_BANK_MASK;
+                return;
+            }
+        }
+        sim_unmapped("write", addr);
+    }
+}
+
+unsigned int sim_mmio_read(unsigned int addr, unsigned int size) {
+    sim_poll();
+    unsigned int value = sim_read(addr);
+    return size == 4 ? value : value & ((1u << (8 * size)) - 1);
+}
+
+void sim_mmio_write(unsigned int addr, unsigned int value, unsigned int size) {
+    sim_poll();
+    sim_write(addr, value);
+    sim_poll();
+}
+
+/* ===== Start-up and Linker Symbols ===== */
+
+/* The heap alloc.c hands out, bounded like the linker script's */
+static char sim_heap[SIM_HEAP_SIZE] __attribute__((aligned(16), used));
+
+#define SIM_STR(x) #x
+#define SIM_XSTR(x) SIM_STR(x)
+asm(".globl _heap_begin\n"
+    ".globl _heap_end\n"
+    ".set _heap_begin, sim_heap\n"
+    ".set _heap_end, sim_heap + " SIM_XSTR(SIM_HEAP_SIZE) "\n");
+
+/* boot.S: enable the timer, switch and button interrupts */
+void enable_interrupt(void) {
+    csr_set(mie, (1u << IRQ_TIMER) | (1u << IRQ_SWITCHES) | (1u << IRQ_BUTTON));
+    csr_set(mstatus, MSTATUS_MIE);
+}
+
+/* sched.c needs the context switch in context.S; there is one task here */
+void sched_irq_exit(void) {
+}
+
+void event_signal(struct event *ev) {
+}
+
+/* crash.c reads the target's trap frame and linker symbols; faults are the host's */
+void crash_handler(const struct crash_frame *frame, unsigned int mcause) {
+    static const char msg[] = "sim: exception reported to crash_handler\n";
+    (void)!write(STDERR_FILENO, msg, sizeof(msg) - 1);
+    abort();
+}
+
+static void sim_exit(void) {
+    csr[SIM_CSR_mstatus] &= ~MSTATUS_MIE;
+    uart_flush();
+    sim_uart_set_drain(0);
+    uart_out_flush();
+}
+
+/* What _start does before main() */
+__attribute__((constructor)) static void sim_boot(void) {
+    epoch_ns = host_ns();
+    atexit(sim_exit);
+    delay_calibrate();
+}
@@ -0,0 +1,65 @@
+#ifndef SIM_H
+#define SIM_H
+
+/*
+ * DTEK-V Host Device Model
+ * Simulated CSRs and peripherals for the host build (`make host`)
+ *
+ * mmio.h and csr.h route every register and CSR access here when built
+ * with -DDTEKV_HOST. mcycle follows the host's monotonic clock scaled to
+ * CPU_CLOCK_HZ, so delays and timer periods keep their wall-clock length.
+ * Interrupts are level-triggered as on the board and are taken at the
+ * next register or CSR access with mstatus.MIE and the mie bit set; the
+ * model performs the trap entry, irq_dispatch() and the mret.
+ *
+ * The functions below let a host program stand in for the outside world:
+ * inject UART input, flip switches, press buttons, drive GPIO inputs and
+ * observe the outputs.
+ */
+
+/* JTAG UART FIFO depths */
+#define SIM_UART_FIFO   64
+#define SIM_UART_WI_MIN 8           /* Free slots that raise the write interrupt */
+
+/* Bytes available to alloc.c between _heap_begin and _heap_end */
+#ifndef SIM_HEAP_SIZE
+#define SIM_HEAP_SIZE 0x100000
+#endif
+
+/* Simulated cycles since start-up (mcycleh:mcycle) */
+unsigned long long sim_cycles(void);
+
+/* Take any pending, enabled interrupt now */
+void sim_poll(void);
+
+/*
+ * Cycles the JTAG UART needs per byte from its transmit FIFO to the host
+ * (stdout); 0 drains instantly (the default). A nonzero rate makes WSPACE
+ * and the write interrupt behave as with a real, slower link.
+ */
+void sim_uart_set_drain(unsigned int cycles_per_byte);
+unsigned int sim_uart_input(const char *buf, unsigned int n);   /* Bytes accepted */
+unsigned int sim_uart_tx_level(void);   /* Bytes waiting in the transmit FIFO */
+
+/*
+ * Send what leaves the transmit FIFO to buf instead of stdout, for tests;
+ * a null buf goes back to stdout. sim_uart_captured() counts the bytes
+ * sent since, of which the first size are kept.
+ */
+void sim_uart_capture(char *buf, unsigned int size);
+unsigned int sim_uart_captured(void);
+
+/* Inputs; changes latch into the edge capture registers */
+void sim_switch_set(unsigned int value);        /* Any edge */
+void sim_button_set(unsigned int value);        /* Rising edge (press) */
+
+/* GPIO: levels seen on pins that are inputs, per bank */
+void sim_gpio_set_input(int bank, unsigned int mask, unsigned int value);
+unsigned int sim_gpio_output(int bank);         /* Levels driven on output pins */
+unsigned int sim_gpio_direction(int bank);
+
+/* Outputs */
+unsigned int sim_led_read(void);
+unsigned int sim_display_read(int n);
+
+#endif /* SIM_H */
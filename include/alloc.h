@@ -0,0 +1,68 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+/*
+ * DTEK-V Memory Allocators
+ * Constant-time allocators carved out of the linker script's .heap region
+ *
+ * - heap_reserve(): permanent bump allocation from .heap, used at startup
+ *   to set up pools and arenas
+ * - pools: fixed-size blocks with the free list threaded through the
+ *   free blocks themselves; alloc and free are O(1) and ISR-safe
+ * - block_alloc()/block_free(): a set of size-class pools
+ * - arenas: resettable bump allocators for per-frame scratch
+ *
+ * All of them track a high-water mark so RAM use can be measured.
+ */
+
+/* Alignment of every allocation */
+#define ALLOC_ALIGN 8
+
+/* ===== Heap Region ===== */
+
+void *heap_reserve(unsigned int size);          /* Never freed, 0 if exhausted */
+unsigned int heap_used(void);
+unsigned int heap_size(void);
+
+/* ===== Fixed-Block Pools ===== */
+
+struct pool {
+    void *free_list;            /* First free block */
+    char *base;                 /* First block */
+    char *end;                  /* One past the last block */
+    unsigned int block_size;
+    unsigned int num_blocks;
+    unsigned int used;          /* Blocks currently allocated */
+    unsigned int high_water;    /* Most blocks ever allocated at once */
+};
+
+int pool_init(struct pool *p, unsigned int block_size, unsigned int num_blocks);
+void *pool_alloc(struct pool *p);               /* 0 if the pool is empty */
+void pool_free(struct pool *p, void *block);
+
+/* ===== Size-Class Allocator ===== */
+
+/* Size classes and blocks per class, smallest first */
+#define ALLOC_NUM_CLASSES 5
+#define ALLOC_CLASS_SIZES  {16, 32, 64, 128, 256}
+#define ALLOC_CLASS_BLOCKS {64, 32, 16, 8, 4}
+
+int alloc_init(void);                           /* Create the class pools */
+void *block_alloc(unsigned int size);           /* 0 if size too big or full */
+void block_free(void *ptr);
+void alloc_report(void);                        /* Print usage per class */
+
+/* ===== Bump Arenas ===== */
+
+struct arena {
+    char *base;
+    unsigned int size;
+    unsigned int used;
+    unsigned int high_water;
+};
+
+int arena_init(struct arena *a, unsigned int size);
+void *arena_alloc(struct arena *a, unsigned int size);  /* 0 if full */
+void arena_reset(struct arena *a);                      /* Free everything */
+
+#endif /* ALLOC_H */
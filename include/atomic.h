@@ -0,0 +1,165 @@
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+/*
+ * DTEK-V Concurrency Primitives
+ * Sharing data between interrupt handlers and main code
+ *
+ * - irq_save()/irq_restore(): nestable critical sections, one csrrc each
+ * - Barriers: compiler and fence-based ordering
+ * - Atomics: AMO instructions when the compiler targets the A extension
+ *   (-march=...a...), otherwise a critical section of a few instructions
+ * - RING_DECLARE(): lock-free single-producer/single-consumer ring
+ */
+
+#include "csr.h"
+
+/* ===== Critical Sections ===== */
+
+/*
+ * Mask interrupts and return the previous mstatus. Sections nest: an
+ * inner irq_restore() leaves interrupts off if they were off on entry.
+ */
+static inline unsigned int irq_save(void) {
+    return csr_read_clear(mstatus, MSTATUS_MIE);
+}
+
+static inline void irq_restore(unsigned int state) {
+    if (state & MSTATUS_MIE)
+        csr_set(mstatus, MSTATUS_MIE);
+}
+
+/* ===== Barriers ===== */
+
+/* Stop the compiler from moving memory accesses across this point */
+#define compiler_barrier() asm volatile("" : : : "memory")
+
+#ifdef DTEKV_HOST
+#define memory_barrier() __sync_synchronize()
+#define io_barrier() __sync_synchronize()
+#else
+/* Order memory accesses in hardware as well (e.g. buffers seen by DMA) */
+#define memory_barrier() asm volatile("fence rw, rw" : : : "memory")
+
+/* Order device register accesses against memory accesses */
+#define io_barrier() asm volatile("fence iorw, iorw" : : : "memory")
+#endif
+
+/* ===== Atomic Operations ===== */
+
+static inline unsigned int atomic_read(const volatile unsigned int *p) {
+    return *p;  /* Aligned word loads and stores are single-copy atomic */
+}
+
+static inline void atomic_write(volatile unsigned int *p, unsigned int v) {
+    *p = v;
+}
+
+/* atomic_fetch_<op>(p, v): *p = *p <op> v, returning the old value */
+#ifdef __riscv_atomic
+#define ATOMIC_FETCH_OP(op, insn, expr) \
+    static inline unsigned int atomic_fetch_##op(volatile unsigned int *p, unsigned int v) { \
+        unsigned int old; \
+        asm volatile(insn " %0, %2, %1" : "=r"(old), "+A"(*p) : "r"(v) : "memory"); \
+        return old; \
+    }
+#else
+#define ATOMIC_FETCH_OP(op, insn, expr) \
+    static inline unsigned int atomic_fetch_##op(volatile unsigned int *p, unsigned int v) { \
+        unsigned int s = irq_save(); \
+        unsigned int old = *p; \
+        *p = (expr); \
+        irq_restore(s); \
+        return old; \
+    }
+#endif
+
+ATOMIC_FETCH_OP(add, "amoadd.w", old + v)
+ATOMIC_FETCH_OP(and, "amoand.w", old & v)
+ATOMIC_FETCH_OP(or, "amoor.w", old | v)
+ATOMIC_FETCH_OP(xor, "amoxor.w", old ^ v)
+ATOMIC_FETCH_OP(swap, "amoswap.w", v)
+
+#undef ATOMIC_FETCH_OP
+
+static inline unsigned int atomic_fetch_sub(volatile unsigned int *p, unsigned int v) {
+    return atomic_fetch_add(p, -v);
+}
+
+/* Store desired if *p == expected; returns the old value either way */
+static inline unsigned int atomic_cas(volatile unsigned int *p, unsigned int expected,
+                                      unsigned int desired) {
+#ifdef __riscv_atomic
+    unsigned int old, fail;
+    asm volatile("1: lr.w %0, %2\n"
+                 "   bne %0, %3, 2f\n"
+                 "   sc.w %1, %4, %2\n"
+                 "   bnez %1, 1b\n"
+                 "2:"
+                 : "=&r"(old), "=&r"(fail), "+A"(*p)
+                 : "r"(expected), "r"(desired)
+                 : "memory");
+    return old;
+#else
+    unsigned int s = irq_save();
+    unsigned int old = *p;
+    if (old == expected)
+        *p = desired;
+    irq_restore(s);
+    return old;
+#endif
+}
+
+/* ===== Lock-Free Ring Buffer ===== */
+
+/*
+ * RING_DECLARE(name, type, size) declares struct name with static inline
+ * name_push(), name_pop(), name_count(), name_empty() and name_full().
+ * size must be a power of two. Safe without locking for one producer and
+ * one consumer, e.g. an ISR and main code: only push writes head and
+ * only pop writes tail.
+ *
+ *     RING_DECLARE(sample_ring, unsigned short, 32)
+ *     static struct sample_ring samples;
+ *     sample_ring_push(&samples, &value);     (in the ISR)
+ *     while (sample_ring_pop(&samples, &value)) ...
+ */
+#define RING_DECLARE(name, type, size) \
+    _Static_assert(((size) & ((size) - 1)) == 0, #name ": size must be a power of two"); \
+    struct name { \
+        type slots[size]; \
+        volatile unsigned int head; \
+        volatile unsigned int tail; \
+    }; \
+    static inline unsigned int name##_count(const struct name *r) { \
+        return r->head - r->tail; \
+    } \
+    static inline int name##_empty(const struct name *r) { \
+        return r->head == r->tail; \
+    } \
+    static inline int name##_full(const struct name *r) { \
+        return r->head - r->tail >= (size); \
+    } \
+    /* Returns 1 on success, 0 if full */ \
+    static inline int name##_push(struct name *r, const type *item) { \
+        unsigned int head = r->head; \
+        if (head - r->tail >= (size)) \
+            return 0; \
+        r->slots[head & ((size) - 1)] = *item; \
+        compiler_barrier(); \
+        r->head = head + 1; \
+        return 1; \
+    } \
+    /* Returns 1 on success, 0 if empty */ \
+    static inline int name##_pop(struct name *r, type *item) { \
+        unsigned int tail = r->tail; \
+        if (tail == r->head) \
+            return 0; \
+        compiler_barrier(); \
+        *item = r->slots[tail & ((size) - 1)]; \
+        compiler_barrier(); \
+        r->tail = tail + 1; \
+        return 1; \
+    }
+
+#endif /* ATOMIC_H */
@@ -0,0 +1,55 @@
+#ifndef BINLOG_H
+#define BINLOG_H
+
+/*
+ * DTEK-V Binary Logger
+ * Deferred-formatting log records decoded on the host
+ *
+ * BINLOG("fmt", args...) sends only a compact record over the JTAG UART:
+ *
+ *   byte 0     BINLOG_MAGIC
+ *   byte 1     number of arguments (0..BINLOG_MAX_ARGS)
+ *   bytes 2-3  format string ID (offset into the .binlog_fmt section)
+ *   bytes 4-7  mcycle timestamp
+ *   then       one 32-bit word per argument
+ *
+ * All fields are little-endian. The format strings live in .binlog_fmt,
+ * which the linker script keeps in the ELF but never loads, so they cost
+ * no target memory. scripts/binlog_decode.py reads them from
+ * build/main.elf and turns a captured UART stream back into text. The
+ * link fails if the strings outgrow the 16-bit ID.
+ *
+ * Arguments must be 32-bit integers; cast pointers to unsigned int. More
+ * than BINLOG_MAX_ARGS of them fail at compile time. Each is sent as one
+ * word, so a 64-bit value would be truncated: the decoder rejects formats
+ * with %lld/%llu/%llx rather than misread the words.
+ * Build with -DBINLOG_TEXT to route BINLOG() through printf() instead.
+ */
+
+#define BINLOG_MAGIC    0xA5
+#define BINLOG_MAX_ARGS 8
+
+#ifdef BINLOG_TEXT
+
+#include "utils.h"
+#define BINLOG(fmt, ...) printf(fmt, ##__VA_ARGS__)
+
+#else
+
+#define BINLOG(fmt, ...) \
+    do { \
+        static const char __binlog_fmt[] \
+            __attribute__((section(".binlog_fmt"), used)) = fmt; \
+        const unsigned int __binlog_args[] = {0, ##__VA_ARGS__}; \
+        _Static_assert(sizeof(__binlog_args) / sizeof(unsigned int) - 1 <= BINLOG_MAX_ARGS, \
+                       "BINLOG: more than BINLOG_MAX_ARGS arguments"); \
+        binlog_emit((unsigned int)__binlog_fmt, __binlog_args + 1, \
+                    sizeof(__binlog_args) / sizeof(unsigned int) - 1); \
+    } while (0)
+
+#endif
+
+/* Emit one record; use the BINLOG() macro instead of calling directly */
+void binlog_emit(unsigned int id, const unsigned int *args, unsigned int nargs);
+
+#endif /* BINLOG_H */
@@ -0,0 +1,46 @@
+#ifndef CONVERT_H
+#define CONVERT_H
+
+/*
+ * DTEK-V Integer-to-Text Conversion
+ * Division-free decimal, hex and binary formatting shared by all printers
+ *
+ * Every function writes the digits most-significant first, NUL-terminates
+ * the buffer and returns the number of digits written. Hex and binary take
+ * a minimum digit count (0 = as many as needed) and zero-pad up to it.
+ */
+
+/* Buffer sizes including the terminating NUL */
+#define CONV_DEC32_SIZE 11      /* 4294967295 */
+#define CONV_DEC64_SIZE 21      /* 18446744073709551615 */
+#define CONV_BUF_SIZE   65      /* Any base, 64 bits */
+
+/* Decimal (reciprocal multiply and a two-digit lookup table) */
+int u32_to_dec(unsigned int value, char *buf);
+int u64_to_dec(unsigned long long value, char *buf);
+int i32_to_dec(int value, char *buf);                     /* With '-' sign */
+
+/* Hexadecimal and binary (shift and mask) */
+int u32_to_hex(unsigned int value, char *buf, int digits, int upper);
+int u64_to_hex(unsigned long long value, char *buf, int digits, int upper);
+int u32_to_bin(unsigned int value, char *buf, int digits);
+
+/* Any base from 2 to 36, using the fast paths above where possible */
+int u64_to_base(unsigned long long value, unsigned int base, char *buf, int upper);
+
+/* Number of decimal digits in value (1-10) */
+int u32_dec_digits(unsigned int value);
+
+/* High 64 bits of a 64x64 product, built from 32-bit multiplies */
+static inline unsigned long long mulhi64(unsigned long long a, unsigned long long b) {
+    unsigned int a0 = (unsigned int)a, a1 = (unsigned int)(a >> 32);
+    unsigned int b0 = (unsigned int)b, b1 = (unsigned int)(b >> 32);
+    unsigned long long p00 = (unsigned long long)a0 * b0;
+    unsigned long long p01 = (unsigned long long)a0 * b1;
+    unsigned long long p10 = (unsigned long long)a1 * b0;
+    unsigned long long p11 = (unsigned long long)a1 * b1;
+    unsigned long long mid = (p00 >> 32) + (unsigned int)p01 + (unsigned int)p10;
+    return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+}
+
+#endif /* CONVERT_H */
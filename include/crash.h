@@ -0,0 +1,72 @@
+#ifndef CRASH_H
+#define CRASH_H
+
+/*
+ * DTEK-V Crash Capture
+ * Post-mortem record of a fault: registers, trap CSRs and a backtrace
+ *
+ * On an exception other than ecall, boot.S saves every register into a
+ * struct crash_frame and handle_exception() passes it to crash_handler().
+ * That fills a struct crash_record with the registers, mcause, mtval,
+ * mepc and mstatus and a backtrace, prints a readable summary, sends the
+ * record in binary for scripts/crash_report.py, and halts or restarts.
+ *
+ * The record lives in the .noinit section, which start-up code does not
+ * clear, so it survives a soft reset to _start: after a restart,
+ * crash_last() returns it if its magic and checksum are intact. A power
+ * cycle or a fresh upload loses it.
+ *
+ * The backtrace is a bounded scan, not a frame-pointer walk (release
+ * builds omit frame pointers): starting at the faulting sp, words that
+ * point just after a jal/jalr ra in the text section are taken as return
+ * addresses. Stale ones from earlier calls can appear between the real
+ * callers, so the host tool marks them as candidates.
+ *
+ * Dump format: the struct crash_record below, little-endian, as is.
+ */
+
+#define CRASH_MAGIC 0x31524344  /* "DCR1" */
+
+/* Backtrace entries kept, and stack words scanned for them */
+#ifndef CRASH_MAX_FRAMES
+#define CRASH_MAX_FRAMES 16
+#endif
+#ifndef CRASH_SCAN_WORDS
+#define CRASH_SCAN_WORDS 2048
+#endif
+
+/* Registers at the fault as saved by boot.S: x[n] is register xn */
+struct crash_frame {
+    unsigned int x[32];         /* x[0] is 0, x[2] is sp before the trap */
+};
+
+struct crash_record {
+    unsigned int magic;         /* CRASH_MAGIC */
+    unsigned int size;          /* sizeof(struct crash_record) */
+    unsigned int mcause;
+    unsigned int mtval;         /* Faulting address or instruction */
+    unsigned int mepc;
+    unsigned int mstatus;
+    unsigned int cycles;        /* mcycle at the fault */
+    unsigned int count;         /* Crashes since the record was last cleared */
+    unsigned int regs[32];      /* x0-x31 */
+    unsigned int depth;         /* Entries used in backtrace[] */
+    unsigned int backtrace[CRASH_MAX_FRAMES];   /* Innermost first */
+    unsigned int checksum;      /* Makes the sum of all words 0 */
+};
+
+/* Called by handle_exception() for faults; does not return */
+void crash_handler(const struct crash_frame *frame, unsigned int mcause);
+
+/* Restart at _start after a crash instead of halting (default: halt) */
+void crash_set_reset(int enable);
+
+/* The record from before the last soft reset, or 0 if none is valid */
+const struct crash_record *crash_last(void);
+void crash_clear(void);
+
+/* Output */
+void crash_print(const struct crash_record *r);     /* Readable summary */
+void crash_dump(const struct crash_record *r);      /* Binary for the host */
+
+#endif /* CRASH_H */
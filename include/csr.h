@@ -0,0 +1,63 @@
+#ifndef CSR_H
+#define CSR_H
+
+/*
+ * DTEK-V CSR Access Helpers
+ * Thin wrappers around the RISC-V Zicsr instructions
+ */
+
+/* mstatus bits */
+#define MSTATUS_MIE  (1 << 3)   /* Machine interrupt enable */
+#define MSTATUS_MPIE (1 << 7)   /* Previous MIE (restored by mret) */
+
+#ifdef DTEKV_HOST
+
+/* Host build: CSRs are registers of the device model in host/sim.c */
+enum {
+    SIM_CSR_mstatus, SIM_CSR_mie, SIM_CSR_mip, SIM_CSR_mtvec, SIM_CSR_mscratch,
+    SIM_CSR_mepc, SIM_CSR_mcause, SIM_CSR_mtval,
+    SIM_CSR_mcycle, SIM_CSR_mcycleh, SIM_CSR_minstret, SIM_CSR_minstreth,
+    SIM_CSR_COUNT
+};
+
+unsigned int sim_csr_read(int csr);
+void sim_csr_write(int csr, unsigned int value);
+unsigned int sim_csr_modify(int csr, unsigned int set, unsigned int clear); /* Old value */
+
+#define csr_read(csr)            sim_csr_read(SIM_CSR_##csr)
+#define csr_write(csr, val)      sim_csr_write(SIM_CSR_##csr, (val))
+#define csr_set(csr, bits)       ((void)sim_csr_modify(SIM_CSR_##csr, (bits), 0))
+#define csr_clear(csr, bits)     ((void)sim_csr_modify(SIM_CSR_##csr, 0, (bits)))
+#define csr_read_clear(csr, bits) sim_csr_modify(SIM_CSR_##csr, 0, (bits))
+
+#else
+
+/* Read a CSR by name, e.g. csr_read(mcycle) */
+#define csr_read(csr) \
+    ({ \
+        unsigned int __v; \
+        asm volatile("csrr %0, " #csr : "=r"(__v)); \
+        __v; \
+    })
+
+/* Write a CSR */
+#define csr_write(csr, val) \
+    asm volatile("csrw " #csr ", %0" : : "r"(val) : "memory")
+
+/* Set / clear bits in a CSR */
+#define csr_set(csr, bits) \
+    asm volatile("csrs " #csr ", %0" : : "r"(bits) : "memory")
+#define csr_clear(csr, bits) \
+    asm volatile("csrc " #csr ", %0" : : "r"(bits) : "memory")
+
+/* Atomically clear bits in a CSR and return its previous value */
+#define csr_read_clear(csr, bits) \
+    ({ \
+        unsigned int __v; \
+        asm volatile("csrrc %0, " #csr ", %1" : "=r"(__v) : "r"(bits) : "memory"); \
+        __v; \
+    })
+
+#endif
+
+#endif /* CSR_H */
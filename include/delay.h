@@ -0,0 +1,49 @@
+#ifndef DELAY_H
+#define DELAY_H
+
+#include "csr.h"
+
+/*
+ * DTEK-V Delay Engine
+ * Busy-wait delays timed by mcycle instead of loop counts
+ *
+ * delay_cycles() spins on mcycle and subtracts the fixed cost of calling
+ * it, measured once at startup by delay_calibrate() (called from boot.S).
+ * The result is the same in debug and release builds and is accurate to
+ * one iteration of the polling loop, a few cycles.
+ */
+
+void delay_calibrate(void);             /* Measure call overhead */
+unsigned int delay_overhead(void);      /* Measured overhead in cycles */
+
+void delay_cycles(unsigned int cycles);
+void delay_ns(unsigned int ns);         /* Up to ~4.29 s */
+void delay_us(unsigned int us);
+
+/*
+ * Spin until mcycle reaches an absolute deadline. Stepping the deadline
+ * by a fixed period paces edges without drift from the work between them.
+ */
+static inline void delay_until(unsigned int deadline) {
+    while ((int)(csr_read(mcycle) - deadline) < 0)
+        ;
+}
+
+/*
+ * End a clock phase of a bit-banged bus: step the deadline by period and
+ * wait for it. If an interrupt already stretched the phase past it, the
+ * schedule restarts from now instead of catching up with short phases
+ * the other side may not accept. A period of 0 does not wait.
+ */
+static inline void delay_pace(unsigned int *deadline, unsigned int period) {
+    if (!period)
+        return;
+    *deadline += period;
+    unsigned int now = csr_read(mcycle);
+    if ((int)(now - *deadline) >= 0)
+        *deadline = now;
+    else
+        delay_until(*deadline);
+}
+
+#endif /* DELAY_H */
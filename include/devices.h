@@ -8,46 +8,85 @@
 
 /* ===== Hardware Register Definitions ===== */
 
+/*
+ * Register addresses; access them with the mmio.h accessors, e.g.
+ * mmio_write16(TIMER_CONTROL, TIMER_CTRL_STOP). The timer registers are
+ * 16 bits wide, all others 32 bits.
+ */
+
+#include "mmio.h"
+
 /* Memory-mapped I/O base addresses */
+#define LED_BASE      0x04000000
+#define DISP_BASE     0x04000050
 #define TIMER_BASE    0x04000020
 #define SWITCHES_BASE 0x04000010
 #define BUTTON_BASE   0x040000D0
 #define JTAG_UART_BASE 0x04000040
+#define GPIO1_BASE    0x040000E0
+#define GPIO2_BASE    0x040000F0
+
+/* 7-segment display registers, one per digit (DISPLAY_COUNT) */
+#define DISP_STRIDE 0x10
+#define DISP_DATA(n) (DISP_BASE + (n) * DISP_STRIDE)
 
 /* Timer registers */
-#define TIMER_STATUS  ((volatile unsigned short *)(TIMER_BASE + 0x00))
-#define TIMER_CONTROL ((volatile unsigned short *)(TIMER_BASE + 0x04))
-#define TIMER_PERIODL ((volatile unsigned short *)(TIMER_BASE + 0x08))
-#define TIMER_PERIODH ((volatile unsigned short *)(TIMER_BASE + 0x0C))
-#define TIMER_SNAPL   ((volatile unsigned short *)(TIMER_BASE + 0x10))
-#define TIMER_SNAPH   ((volatile unsigned short *)(TIMER_BASE + 0x14))
+#define TIMER_STATUS  (TIMER_BASE + 0x00)
+#define TIMER_CONTROL (TIMER_BASE + 0x04)
+#define TIMER_PERIODL (TIMER_BASE + 0x08)
+#define TIMER_PERIODH (TIMER_BASE + 0x0C)
+#define TIMER_SNAPL   (TIMER_BASE + 0x10)
+#define TIMER_SNAPH   (TIMER_BASE + 0x14)
+
+/* Timer register bits */
+#define TIMER_STATUS_TO  0x1    /* Timeout occurred */
+#define TIMER_STATUS_RUN 0x2    /* Counter running */
+#define TIMER_CTRL_ITO   0x1    /* Interrupt on timeout */
+#define TIMER_CTRL_CONT  0x2    /* Continuous (reload) mode */
+#define TIMER_CTRL_START 0x4    /* Start counting */
+#define TIMER_CTRL_STOP  0x8    /* Stop counting */
 
 /* Switch registers */
-#define SW_DATA         ((volatile unsigned int *)(SWITCHES_BASE + 0x00))
-#define SW_DIRECTION    ((volatile unsigned int *)(SWITCHES_BASE + 0x04))
-#define SW_IRQ_MASK     ((volatile unsigned int *)(SWITCHES_BASE + 0x08))
-#define SW_EDGE_CAPTURE ((volatile unsigned int *)(SWITCHES_BASE + 0x0C))
+#define SW_DATA         (SWITCHES_BASE + 0x00)
+#define SW_DIRECTION    (SWITCHES_BASE + 0x04)
+#define SW_IRQ_MASK     (SWITCHES_BASE + 0x08)
+#define SW_EDGE_CAPTURE (SWITCHES_BASE + 0x0C)
 
 /* Button registers */
-#define BTN_DATA         ((volatile unsigned int *)(BUTTON_BASE + 0x00))
-#define BTN_DIRECTION    ((volatile unsigned int *)(BUTTON_BASE + 0x04))
-#define BTN_IRQ_MASK     ((volatile unsigned int *)(BUTTON_BASE + 0x08))
-#define BTN_EDGE_CAPTURE ((volatile unsigned int *)(BUTTON_BASE + 0x0C))
+#define BTN_DATA         (BUTTON_BASE + 0x00)
+#define BTN_DIRECTION    (BUTTON_BASE + 0x04)
+#define BTN_IRQ_MASK     (BUTTON_BASE + 0x08)
+#define BTN_EDGE_CAPTURE (BUTTON_BASE + 0x0C)
 
 /* JTAG UART registers */
-#define JTAG_UART_DATA ((volatile unsigned int *)(JTAG_UART_BASE + 0x00))
-#define JTAG_UART_CTRL ((volatile unsigned int *)(JTAG_UART_BASE + 0x04))
+#define JTAG_UART_DATA (JTAG_UART_BASE + 0x00)
+#define JTAG_UART_CTRL (JTAG_UART_BASE + 0x04)
 
 /* JTAG UART control register bits */
 #define JTAG_UART_WSPACE_MASK 0xFFFF0000  /* Write space available */
+#define JTAG_UART_RAVAIL_MASK 0xFFFF0000  /* Bytes left in the read FIFO */
 #define JTAG_UART_RVALID_MASK 0x00008000  /* Read valid bit */
 #define JTAG_UART_DATA_MASK   0x000000FF  /* Data byte mask */
+#define JTAG_UART_CTRL_RE     0x00000001  /* Read interrupt enable */
+#define JTAG_UART_CTRL_WE     0x00000002  /* Write interrupt enable */
+#define JTAG_UART_CTRL_RI     0x00000100  /* Read interrupt pending */
+#define JTAG_UART_CTRL_WI     0x00000200  /* Write interrupt pending */
+
+/* GPIO registers: bank 0 = pins 0-19 (GPIO1), bank 1 = pins 20-39 (GPIO2) */
+#define GPIO_BANK_STRIDE 0x10
+#define GPIO_DATA(bank) (GPIO1_BASE + (bank) * GPIO_BANK_STRIDE + 0x00)
+#define GPIO_DIR(bank)  (GPIO1_BASE + (bank) * GPIO_BANK_STRIDE + 0x04)
 
 /* Interrupt source definitions */
 #define IRQ_TIMER    16
 #define IRQ_SWITCHES 17
 #define IRQ_BUTTON   18
 
+/* JTAG UART IRQ line (not listed in the DTEK-V IRQ table, override with -D) */
+#ifndef IRQ_JTAG_UART
+#define IRQ_JTAG_UART 19
+#endif
+
 /* ===== High-Level Device Drivers ===== */
 
 /* LED Functions */
@@ -59,6 +98,15 @@ void led_toggle(int led_num);
 unsigned int led_get(void);
 
 /* 7-Segment Display Functions */
+#define DISPLAY_COUNT  6
+#define DISPLAY_BLANK  0xFF     /* All segments off (active low) */
+#define DISPLAY_SEG_DP 0x80     /* Decimal point bit */
+
+/* Flags for display_number() / display_fixed() */
+#define DISPLAY_HEX      0x1    /* Hexadecimal instead of signed decimal */
+#define DISPLAY_ZERO_PAD 0x2    /* Pad with zeros to all six digits */
+#define DISPLAY_LEFT     0x4    /* Left-align instead of right-align */
+
 void display_init(void);
 void display_clear(int display_num);
 void display_clear_all(void);
@@ -66,6 +114,17 @@ void display_hex(unsigned int number);      /* Display as hexadecimal */
 void display_decimal(unsigned int number);  /* Display as decimal */
 void display_digit(int display_num, unsigned char digit); /* Show 0-F on one display */
 void display_string(const char *str);       /* Display up to 6 characters */
+void display_number(int value, int flags);  /* Formatted, "------" on overflow */
+void display_fixed(int value, int decimals, int flags); /* value / 10^decimals */
+
+/* Shadow buffer: updates are written to hardware by display_commit() */
+void display_commit(void);                  /* Write changed digits only */
+void display_set_autocommit(int enable);    /* 1 (default): commit after each call */
+void display_set_segments(int display_num, unsigned char segments); /* Raw, active low */
+unsigned char display_get_segments(int display_num);
+void display_set_frame(const unsigned char *frame); /* 6 patterns, [0] = rightmost */
+void display_set_dp(int display_num, int on);
+unsigned char display_encode_char(char c);  /* Segment pattern, blank if unsupported */
 
 /* Button Functions */
 void button_init(void);
@@ -77,7 +136,13 @@ unsigned int switch_read(void);
 int switch_get(int switch_num);
 
 /* GPIO Functions */
-#define GPIO_PIN_COUNT 40
+#define GPIO_PIN_COUNT  40
+#define GPIO_BANK_COUNT 2
+#define GPIO_BANK_PINS  20          /* Pin n is bit n % 20 of bank n / 20 */
+#define GPIO_BANK_MASK  0x000FFFFF
+
+#define GPIO_PIN_BANK(pin) ((pin) / GPIO_BANK_PINS)
+#define GPIO_PIN_MASK(pin) (1u << ((pin) % GPIO_BANK_PINS))
 
 void gpio_init(void);
 void gpio_set_direction(int pin, int output);  /* 1=output, 0=input */
@@ -85,4 +150,34 @@ void gpio_write(int pin, int value);
 int gpio_read(int pin);
 void gpio_toggle(int pin);
 
+/* Port access: every pin in mask changes with a single register store */
+void gpio_port_set_direction(int bank, unsigned int mask, unsigned int outputs);
+void gpio_port_write(int bank, unsigned int mask, unsigned int value);
+unsigned int gpio_port_read(int bank);
+void gpio_port_set(int bank, unsigned int mask);
+void gpio_port_clear(int bank, unsigned int mask);
+void gpio_port_toggle(int bank, unsigned int mask);
+
+/* Pin groups: a logical N-bit bus on arbitrary pins of both banks */
+#define GPIO_GROUP_MAX 32
+
+struct gpio_run {
+    unsigned char bank;
+    unsigned char first_bit;        /* Lowest logical bit of the run */
+    unsigned char pin_bit;          /* Bit of that pin within the bank */
+    unsigned char width;
+};
+
+struct gpio_group {
+    unsigned char width;
+    unsigned char run_count;
+    unsigned int bank_mask[GPIO_BANK_COUNT];
+    struct gpio_run runs[GPIO_GROUP_MAX];
+};
+
+int gpio_group_init(struct gpio_group *g, const unsigned char *pins, int width); /* pins[0] = bit 0 */
+void gpio_group_set_direction(const struct gpio_group *g, int output);
+void gpio_group_write(const struct gpio_group *g, unsigned int value);
+unsigned int gpio_group_read(const struct gpio_group *g);
+
 #endif /* DEVICES_H */
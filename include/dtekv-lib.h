@@ -11,7 +11,44 @@
 void printc(char c);                            /* Print single character */
 void print(char *s);                            /* Print string */
 char readc(void);                               /* Read character (non-blocking) */
-int read_available(void);                       /* Check if input available */
+int read_available(void);                       /* Bytes waiting to be read */
+
+/* ===== Buffered JTAG UART ===== */
+
+/* Size of the transmit ring buffer in bytes (must be a power of two) */
+#ifndef UART_TX_BUF_SIZE
+#define UART_TX_BUF_SIZE 1024
+#endif
+
+/* Size of the receive ring buffer in bytes (must be a power of two) */
+#ifndef UART_RX_BUF_SIZE
+#define UART_RX_BUF_SIZE 256
+#endif
+
+/* What printc()/print() do when the transmit buffer is full */
+#define UART_TX_BLOCK     0     /* Drain synchronously until space frees up */
+#define UART_TX_DROP      1     /* Discard the new byte */
+#define UART_TX_OVERWRITE 2     /* Discard the oldest queued byte */
+
+struct uart_stats {
+    unsigned int tx_dropped;     /* Bytes discarded under UART_TX_DROP */
+    unsigned int tx_overwritten; /* Bytes discarded under UART_TX_OVERWRITE */
+    unsigned int tx_high_water;  /* Largest number of bytes ever queued */
+    unsigned int rx_overflow;    /* Received bytes lost to a full buffer */
+    unsigned int rx_line_truncated; /* Lines cut short by uart_readline() */
+    unsigned int rx_high_water;  /* Largest number of bytes ever buffered */
+};
+
+void uart_write(const char *buf, int n);        /* Queue n bytes for transmit */
+void uart_flush(void);                          /* Block until TX buffer is empty */
+unsigned int uart_tx_pending(void);             /* Bytes still queued */
+void uart_set_tx_policy(int policy);            /* UART_TX_BLOCK/DROP/OVERWRITE */
+void uart_set_tx_irq(int enable);               /* Drain from the UART interrupt */
+int uart_read(char *buf, int n);                /* Read up to n bytes (non-blocking) */
+int uart_readline(char *buf, int size);         /* Next complete line, or -1 */
+void uart_set_rx_irq(int enable);               /* Fill from the UART interrupt */
+void uart_get_stats(struct uart_stats *stats);  /* Snapshot of the counters */
+void uart_isr(void);                            /* JTAG UART interrupt service */
 
 /* ===== Number Formatting ===== */
 
@@ -27,6 +64,12 @@ void handle_exception(unsigned arg0, unsigned arg1, unsigned arg2, unsigned arg3
                      unsigned arg4, unsigned arg5, unsigned mcause, unsigned syscall_num);
 void handle_interrupt(unsigned cause);
 
+/* Default device handlers, installed in the irq.h dispatch table */
+void handle_timer_irq(unsigned int cause, void *ctx);
+void handle_switch_irq(unsigned int cause, void *ctx);
+void handle_button_irq(unsigned int cause, void *ctx);
+void handle_uart_irq(unsigned int cause, void *ctx);
+
 /* ===== ISR Function Pointers ===== */
 /* Set these to your interrupt handlers */
 
@@ -36,7 +79,7 @@ extern void (*button_isr)(unsigned int button_state);
 
 /* ===== Utility Functions ===== */
 
-void delay(unsigned int cycles);                /* Simple delay loop */
+void delay(unsigned int cycles);                /* Busy-wait N clock cycles */
 void enable_interrupt(void);                    /* Enable global interrupts */
 
 #endif /* DTEKV_LIB_H */
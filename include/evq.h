@@ -0,0 +1,74 @@
+#ifndef EVQ_H
+#define EVQ_H
+
+/*
+ * DTEK-V Deferred Event Queue
+ * Lock-free single-producer/single-consumer ring from ISRs to main code
+ *
+ * Interrupt handlers post a compact event (source, state, edge bits,
+ * timestamp) in a few instructions and return; the main loop or a
+ * scheduler task drains the queue in batches outside trap context.
+ *
+ * Only the producer writes head and only the consumer writes tail, so no
+ * locking is needed. The producer side must not be re-entered: post from
+ * handlers that do not nest into each other (the default, since all
+ * sources share one priority) or give each priority its own queue.
+ */
+
+struct event;
+
+/* Slots per queue (power of two) */
+#ifndef EVQ_SIZE
+#define EVQ_SIZE 64
+#endif
+
+struct evq_event {
+    unsigned int time;          /* mcycle (low word) when posted */
+    unsigned short source;      /* IRQ cause of the posting handler */
+    unsigned short state;       /* Device state, e.g. switch positions */
+    unsigned int edges;         /* Edge-capture bits */
+};
+
+struct evq {
+    struct evq_event slots[EVQ_SIZE];
+    volatile unsigned int head; /* Next slot to fill; producer only */
+    volatile unsigned int tail; /* Next slot to drain; consumer only */
+    struct event *notify;       /* Optional scheduler event signalled per post */
+    unsigned int posted;        /* Events accepted */
+    unsigned int dropped;       /* Events lost to a full queue */
+    unsigned int overflows;     /* Times the queue became full */
+    unsigned int max_depth;     /* Deepest the queue has been */
+    int full;                   /* Last post was dropped */
+};
+
+struct evq_stats {
+    unsigned int posted;
+    unsigned int dropped;
+    unsigned int overflows;
+    unsigned int max_depth;
+    unsigned int depth;         /* Events waiting now */
+};
+
+typedef void (*evq_handler_t)(const struct evq_event *ev, void *ctx);
+
+/* Events posted by the default switch, button and timer handlers */
+extern struct evq irq_events;
+
+void evq_init(struct evq *q, struct event *notify);
+
+/* Producer (ISR) side */
+int evq_post(struct evq *q, unsigned int source, unsigned int state,
+             unsigned int edges);                   /* 0, or -1 if dropped */
+
+/* Consumer side */
+int evq_pop(struct evq *q, struct evq_event *ev);   /* 1 if an event was read */
+int evq_drain(struct evq *q, evq_handler_t handler, void *ctx,
+              unsigned int max);                    /* Events handled; 0 = no limit */
+unsigned int evq_depth(const struct evq *q);
+
+/* Diagnostics */
+void evq_get_stats(const struct evq *q, struct evq_stats *stats);
+void evq_print_event(const struct evq_event *ev, void *ctx);   /* evq_handler_t */
+void evq_report(const struct evq *q, const char *name);
+
+#endif /* EVQ_H */
@@ -0,0 +1,54 @@
+#ifndef I2C_H
+#define I2C_H
+
+/*
+ * DTEK-V Bit-Banged I2C Master
+ * Open-drain on any two GPIO pins, with clock stretching
+ *
+ * The output latches stay low; a line is pulled low by switching its pin
+ * to output and released by switching it back to input, so external
+ * pull-ups are required. After SCL is released the master waits for it
+ * to read high, which lets a slave stretch the clock for up to the
+ * stretch timeout. Clock phases are paced against mcycle deadlines.
+ */
+
+/* Return codes */
+#define I2C_OK          0
+#define I2C_ERR_NACK    -1          /* Address or data byte not acknowledged */
+#define I2C_ERR_TIMEOUT -2          /* SCL held low past the stretch timeout */
+#define I2C_ERR_BUS     -3          /* A line is stuck low or arbitration was lost */
+
+#define I2C_STANDARD_HZ 100000
+#define I2C_FAST_HZ     400000
+
+/* Default limit for clock stretching */
+#define I2C_STRETCH_US  10000
+
+struct i2c_bus {
+    unsigned char scl_bank, sda_bank;
+    unsigned int scl_mask, sda_mask;
+    unsigned int half_period;       /* Cycles per clock phase, 0 = no pacing */
+    unsigned int stretch_limit;     /* Cycles a slave may hold SCL low */
+    unsigned int deadline;          /* mcycle at the end of the current phase */
+    int active;                     /* Between start and stop */
+};
+
+/* Returns I2C_OK, -1 for a bad pin, or I2C_ERR_BUS if SDA cannot be freed */
+int i2c_init(struct i2c_bus *bus, int scl, int sda, unsigned int hz);
+void i2c_set_rate(struct i2c_bus *bus, unsigned int hz);            /* 0 = fastest */
+void i2c_set_stretch_timeout(struct i2c_bus *bus, unsigned int us);
+
+/* Transactions with 7-bit addresses; return I2C_OK or an error code */
+int i2c_write(struct i2c_bus *bus, int addr, const unsigned char *buf, unsigned int n);
+int i2c_read(struct i2c_bus *bus, int addr, unsigned char *buf, unsigned int n);
+int i2c_write_read(struct i2c_bus *bus, int addr, const unsigned char *tx,
+                   unsigned int ntx, unsigned char *rx, unsigned int nrx); /* Repeated start */
+int i2c_probe(struct i2c_bus *bus, int addr);   /* I2C_OK if a device acknowledges */
+
+/* Bus primitives for protocols the transactions above do not cover */
+int i2c_start(struct i2c_bus *bus);             /* Repeated start if already active */
+int i2c_stop(struct i2c_bus *bus);
+int i2c_write_byte(struct i2c_bus *bus, unsigned int byte);    /* I2C_OK on ACK */
+int i2c_read_byte(struct i2c_bus *bus, int ack);               /* Byte, or an error */
+
+#endif /* I2C_H */
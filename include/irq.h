@@ -0,0 +1,67 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+/*
+ * DTEK-V Interrupt Registration
+ * Table-driven interrupt dispatch indexed by cause
+ *
+ * The vectored trap table in boot.S hands each interrupt's cause to
+ * irq_dispatch(), which calls the registered handler with one indexed
+ * load. Sources are enabled individually in mie. A handler whose
+ * priority is below that of another enabled source runs with interrupts
+ * re-enabled for the higher-priority sources only, so they can nest.
+ * Which sources are enabled is read from mie at each interrupt, so those
+ * turned on by enable_interrupt() or a direct csr_set(mie, ...) nest the
+ * same as those turned on by irq_enable().
+ *
+ * The timer, switch, button and JTAG UART causes start out with the
+ * library's default handlers, which still call timer_isr, switch_isr and
+ * button_isr.
+ */
+
+/* Causes covered by the dispatch table (mie is 32 bits wide) */
+#define IRQ_MAX 32
+
+/* Priorities: higher values may preempt lower ones */
+#define IRQ_PRIO_LOW     0
+#define IRQ_PRIO_NORMAL  1
+#define IRQ_PRIO_HIGH    2
+#define IRQ_PRIO_URGENT  3
+#define IRQ_NUM_PRIO     4
+
+/* Handlers get the cause, so one handler can serve several sources */
+typedef void (*irq_handler_t)(unsigned int cause, void *ctx);
+
+struct irq_stats {
+    unsigned int count;         /* Invocations */
+    unsigned int max_cycles;    /* Worst-case handler duration */
+};
+
+/* Registration; a null handler restores the default. Does not enable. */
+int irq_register(unsigned int cause, irq_handler_t handler, void *ctx, int priority);
+
+/* Per-source enable through mie */
+void irq_enable(unsigned int cause);
+void irq_disable(unsigned int cause);
+int irq_is_enabled(unsigned int cause);
+
+/* Statistics */
+void irq_get_stats(unsigned int cause, struct irq_stats *stats);
+void irq_reset_stats(void);
+void irq_report(void);
+
+/* Called by the trap entry in boot.S */
+void irq_dispatch(unsigned int cause);
+
+/*
+ * For handlers: mepc and the trap frame (see boot.S) of the code the
+ * interrupt was taken from. A nested trap overwrites mepc and mscratch,
+ * so handlers running with interrupts re-enabled must use these.
+ */
+unsigned int irq_interrupted_pc(void);
+const unsigned int *irq_interrupted_frame(void);
+
+/* Number of handlers currently running with interrupts re-enabled */
+extern volatile unsigned int irq_nesting;
+
+#endif /* IRQ_H */
@@ -0,0 +1,101 @@
+#ifndef LOGIC_H
+#define LOGIC_H
+
+/*
+ * DTEK-V Logic Analyzer
+ * Samples both GPIO banks into RAM and dumps the capture for the host
+ *
+ * Only changes are stored: a record holds the 40 pin levels and the cycle
+ * they were first seen, and identical samples after it are folded into
+ * the record (its run lasts until the next record's time). A capture
+ * arms, keeps the last pre_records records in a ring until a pin in the
+ * trigger mask changes, then fills the rest of the buffer.
+ *
+ * Dump format (little-endian), sent by logic_dump():
+ *
+ *   bytes 0-3    LOGIC_MAGIC "DLA1"
+ *   bytes 4-7    CPU clock in Hz
+ *   bytes 8-11   sample interval in cycles (0 = as fast as possible)
+ *   bytes 12-15  number of records
+ *   bytes 16-19  index of the trigger record (LOGIC_NO_TRIGGER if none)
+ *   bytes 20-23  end of the capture, in cycles
+ *   bytes 24-27  samples taken
+ *   then         per record: 4-byte time, 4 bytes pins 0-31, 1 byte pins 32-39
+ *
+ * Times are cycles since the capture was armed. scripts/logic_vcd.py turns
+ * a dump into a VCD file for a waveform viewer.
+ */
+
+#define LOGIC_MAGIC      0x31414C44  /* "DLA1" */
+#define LOGIC_NO_TRIGGER 0xFFFFFFFFu
+
+/* Records in the capture buffer (12 bytes each) */
+#ifndef LOGIC_MAX_RECORDS
+#define LOGIC_MAX_RECORDS 4096
+#endif
+
+/*
+ * Cycles logic_run() uses for a 0 timeout or duration (4 s): it holds
+ * interrupts off, so waiting forever would hang the board
+ */
+#ifndef LOGIC_RUN_LIMIT
+#define LOGIC_RUN_LIMIT (CPU_CLOCK_HZ * 4u)
+#endif
+
+/* Capture states */
+#define LOGIC_IDLE      0
+#define LOGIC_ARMED     1           /* Waiting for the trigger */
+#define LOGIC_TRIGGERED 2           /* Filling the post-trigger buffer */
+#define LOGIC_DONE      3
+
+struct logic_config {
+    unsigned int trigger[2];        /* Per bank: pins whose change triggers; 0 = trigger at once */
+    unsigned int interval;          /* Cycles between samples; 0 = as fast as possible */
+    unsigned int pre_records;       /* Records kept from before the trigger */
+    unsigned int post_records;      /* Records after it (incl. trigger); 0 = fill the buffer */
+    unsigned int duration;          /* Cycles to capture after the trigger; 0 = no limit */
+    unsigned int timeout;           /* Cycles to wait for the trigger; 0 = forever */
+                                    /* (both LOGIC_RUN_LIMIT under logic_run()) */
+};
+
+struct logic_record {
+    unsigned int time;              /* Cycles since arming */
+    unsigned int pins[2];           /* Bank levels */
+};
+
+struct logic_stats {
+    int state;
+    unsigned int records;
+    unsigned int samples;           /* Samples taken, including folded ones */
+    unsigned int trigger;           /* Record index, LOGIC_NO_TRIGGER if none */
+    unsigned int trigger_time;
+    unsigned int end_time;
+};
+
+/* Arm a capture; samples are then taken by logic_sample() or logic_run() */
+void logic_arm(const struct logic_config *cfg);
+
+/* Take one sample; callable from a timer callback or inside a driver loop */
+int logic_sample(void);                     /* 0 once the capture is done */
+
+/*
+ * Sample until done with interrupts held off; 0, or -1 on trigger timeout.
+ * A 0 timeout or duration stands for LOGIC_RUN_LIMIT cycles here.
+ */
+int logic_run(void);
+
+/* Arm and run in one call */
+int logic_capture(const struct logic_config *cfg);
+
+void logic_stop(void);
+int logic_state(void);
+
+/* Records in time order; 0 if index is out of range */
+const struct logic_record *logic_get_record(unsigned int index);
+
+/* Output */
+void logic_dump(void);                      /* Binary dump over JTAG UART */
+void logic_get_stats(struct logic_stats *stats);
+void logic_report(void);
+
+#endif /* LOGIC_H */
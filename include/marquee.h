@@ -0,0 +1,35 @@
+#ifndef MARQUEE_H
+#define MARQUEE_H
+
+/*
+ * DTEK-V Display Animation
+ * Scrolling text and blinking on the 7-segment displays, driven by a
+ * software timer (timer.h)
+ *
+ * The text is encoded through the display character table once when an
+ * animation starts. Each timer tick then moves the six-digit window and
+ * hands the frame to the display shadow buffer, which writes only the
+ * digits that changed. Nothing runs in the main loop while the text
+ * moves; timer_service_init() must have been called.
+ *
+ * Other display_* calls made while an animation runs are overwritten by
+ * the next tick, so call marquee_stop() first.
+ */
+
+/* Longest text, in display positions ('.' merges into the previous one) */
+#ifndef MARQUEE_MAX_LEN
+#define MARQUEE_MAX_LEN 128
+#endif
+
+/* Scroll modes */
+#define MARQUEE_ONCE   0    /* Scroll in from the right, out to the left, stop */
+#define MARQUEE_LOOP   1    /* As MARQUEE_ONCE, repeated */
+#define MARQUEE_BOUNCE 2    /* Slide back and forth; text stays on screen */
+
+/* Both return -1 before timer_service_init() */
+int marquee_start(const char *text, unsigned int step_ms, int mode);
+int marquee_blink(unsigned int period_ms);      /* Blink the current display content */
+void marquee_stop(void);                        /* Stop; the display keeps its content */
+int marquee_active(void);                       /* 0 once a MARQUEE_ONCE scroll ends */
+
+#endif /* MARQUEE_H */
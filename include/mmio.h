@@ -0,0 +1,54 @@
+#ifndef MMIO_H
+#define MMIO_H
+
+/*
+ * DTEK-V Register Access
+ * All device register reads and writes go through these accessors
+ *
+ * On the target each accessor is a single volatile load or store. A host
+ * build (-DDTEKV_HOST, `make host`) routes them to the device model in
+ * host/sim.c instead, so the drivers run unchanged on a development
+ * machine. Addresses are the physical register addresses from devices.h.
+ */
+
+#ifdef DTEKV_HOST
+
+unsigned int sim_mmio_read(unsigned int addr, unsigned int size);
+void sim_mmio_write(unsigned int addr, unsigned int value, unsigned int size);
+
+#define mmio_read8(addr)      ((unsigned char)sim_mmio_read((addr), 1))
+#define mmio_read16(addr)     ((unsigned short)sim_mmio_read((addr), 2))
+#define mmio_read32(addr)     sim_mmio_read((addr), 4)
+#define mmio_write8(addr, v)  sim_mmio_write((addr), (unsigned char)(v), 1)
+#define mmio_write16(addr, v) sim_mmio_write((addr), (unsigned short)(v), 2)
+#define mmio_write32(addr, v) sim_mmio_write((addr), (v), 4)
+
+#else
+
+static inline unsigned char mmio_read8(unsigned int addr) {
+    return *(volatile unsigned char *)addr;
+}
+
+static inline unsigned short mmio_read16(unsigned int addr) {
+    return *(volatile unsigned short *)addr;
+}
+
+static inline unsigned int mmio_read32(unsigned int addr) {
+    return *(volatile unsigned int *)addr;
+}
+
+static inline void mmio_write8(unsigned int addr, unsigned char value) {
+    *(volatile unsigned char *)addr = value;
+}
+
+static inline void mmio_write16(unsigned int addr, unsigned short value) {
+    *(volatile unsigned short *)addr = value;
+}
+
+static inline void mmio_write32(unsigned int addr, unsigned int value) {
+    *(volatile unsigned int *)addr = value;
+}
+
+#endif
+
+#endif /* MMIO_H */
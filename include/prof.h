@@ -0,0 +1,71 @@
+#ifndef PROF_H
+#define PROF_H
+
+/*
+ * DTEK-V Sampling Profiler
+ * Statistical PC histogram taken from the timer interrupt
+ *
+ * A soft timer fires at the sampling rate and its callback counts the
+ * interrupted mepc into a histogram over the text section; with
+ * PROF_CALLERS the interrupted ra is counted into a second one, which
+ * attributes time spent in leaf functions to their callers. Buckets are
+ * 2^shift bytes wide, with the smallest shift (at least one instruction)
+ * that covers _text_begin.._text_end in PROF_MAX_BUCKETS buckets.
+ *
+ * Each sample costs one soft timer expiry plus a few loads and stores,
+ * and the sampling period is dithered by +-1/32 so loops that run in
+ * step with the timer are not over- or under-counted.
+ *
+ * Dump format (little-endian), sent by prof_dump():
+ *
+ *   bytes 0-3    PROF_MAGIC "DPF1"
+ *   bytes 4-7    CPU clock in Hz
+ *   bytes 8-11   sampling rate in Hz
+ *   bytes 12-15  address of bucket 0 (_text_begin)
+ *   bytes 16-19  bucket shift (bucket n starts at base + (n << shift))
+ *   bytes 20-23  number of buckets
+ *   bytes 24-27  samples taken
+ *   bytes 28-31  samples with mepc outside the text section
+ *   bytes 32-35  flags (PROF_CALLERS)
+ *   bytes 36-39  number of nonzero PC buckets
+ *   bytes 40-43  number of nonzero caller buckets
+ *   then         per nonzero PC bucket: 4-byte index, 4-byte count
+ *   then         the same for the caller buckets
+ *
+ * scripts/prof_report.py symbolizes a dump against build/main.elf.txt.
+ */
+
+#define PROF_MAGIC 0x31465044   /* "DPF1" */
+
+/* Buckets per histogram; one word each in both the PC and caller one */
+#ifndef PROF_MAX_BUCKETS
+#define PROF_MAX_BUCKETS 4096
+#endif
+
+/* Highest sampling rate prof_start() accepts; this bounds the overhead */
+#ifndef PROF_MAX_RATE
+#define PROF_MAX_RATE 10000
+#endif
+
+/* Flags for prof_start() */
+#define PROF_CALLERS 0x1        /* Also histogram the interrupted ra */
+
+struct prof_stats {
+    unsigned int samples;       /* Taken since the last reset */
+    unsigned int outside;       /* mepc not in the text section */
+    unsigned int rate_hz;       /* 0 when stopped */
+    unsigned int shift;         /* log2 of the bucket width in bytes */
+    unsigned int buckets;       /* Buckets in use */
+};
+
+/* Sampling; prof_start() starts the timer service (tickless) if needed */
+int prof_start(unsigned int rate_hz, int flags);
+void prof_stop(void);
+void prof_reset(void);
+
+/* Results */
+void prof_dump(void);           /* Binary dump over the JTAG UART */
+void prof_get_stats(struct prof_stats *stats);
+void prof_report(void);         /* Readable summary and top buckets */
+
+#endif /* PROF_H */
@@ -0,0 +1,65 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+/*
+ * DTEK-V Task Scheduler
+ * Cooperative round-robin scheduler with stackful tasks
+ *
+ * sched_init() turns main() into the first task. Further tasks get their
+ * own stacks from the linker script's task stack region and run until
+ * they yield(), sleep or wait on an event; waiting costs a context switch
+ * instead of a busy loop. When nothing is runnable the scheduler spins
+ * with interrupts enabled until a sleeper is due or an ISR signals an
+ * event.
+ *
+ * sched_set_preempt() adds an optional time slice driven by the software
+ * timer service (timer.h), which forces a yield on interrupt exit.
+ */
+
+/* Maximum number of tasks, including main */
+#ifndef SCHED_MAX_TASKS
+#define SCHED_MAX_TASKS 8
+#endif
+
+/* Smallest task stack; must hold a trap frame plus handler calls */
+#define SCHED_MIN_STACK 1024
+
+/* Task states */
+#define TASK_READY    0
+#define TASK_SLEEPING 1
+#define TASK_WAITING  2
+#define TASK_DONE     3
+
+/* Counting event: each signal releases one wait */
+struct event {
+    volatile unsigned int count;
+};
+
+#define EVENT_INIT { 0 }
+
+/* Scheduler */
+void sched_init(void);                          /* main() becomes task 0 */
+int task_create(const char *name, void (*entry)(void *arg), void *arg,
+                unsigned int stack_size);       /* Task id, -1 on failure */
+void task_exit(void);                           /* Also called when entry returns */
+int task_current(void);
+
+/* Blocking primitives */
+void yield(void);
+void sleep_until(unsigned long long cycles);    /* Absolute mcycle deadline */
+void task_sleep_us(unsigned int us);
+void event_wait(struct event *ev);
+void event_signal(struct event *ev);            /* Safe to call from ISRs */
+
+/* Preemption */
+void sched_set_preempt(unsigned int slice_us);  /* 0 disables */
+void sched_irq_exit(void);                      /* Called on interrupt exit */
+extern volatile int sched_need_resched;         /* Tested by the trap exit in boot.S */
+
+/* Diagnostics */
+void sched_report(void);                        /* Print tasks and stack usage */
+
+/* Context switch (context.S) */
+void ctx_switch(unsigned long *save_sp, unsigned long next_sp);
+
+#endif /* SCHED_H */
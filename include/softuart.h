@@ -0,0 +1,41 @@
+#ifndef SOFTUART_H
+#define SOFTUART_H
+
+/*
+ * DTEK-V Software UART
+ * 8N1 transmit and receive on any GPIO pins, bits timed by mcycle
+ *
+ * Bit edges are placed at absolute mcycle deadlines with interrupts held
+ * off for the start and data bits of each frame; the stop bit runs with
+ * interrupts enabled, since stretching it is harmless. Receiving holds
+ * interrupts off from the wait for the start bit to the middle of the
+ * stop bit, sampling each bit at its centre.
+ */
+
+#define SOFTUART_NO_PIN 0xFF        /* For a transmit- or receive-only UART */
+
+/* softuart_getc() errors */
+#define SOFTUART_TIMEOUT -1
+#define SOFTUART_FRAMING -2         /* Stop bit was low */
+
+struct softuart {
+    unsigned char tx, rx;
+    unsigned char tx_bank, rx_bank;
+    unsigned int tx_mask, rx_mask;
+    unsigned int bit_period;        /* Cycles per bit */
+    unsigned int deadline;          /* End of the last stop bit sent */
+};
+
+/* Returns 0, or -1 on a bad pin or a zero baud rate */
+int softuart_init(struct softuart *u, int tx, int rx, unsigned int baud);
+void softuart_set_baud(struct softuart *u, unsigned int baud);
+
+void softuart_putc(struct softuart *u, unsigned char c);
+void softuart_write(struct softuart *u, const unsigned char *buf, unsigned int n);
+
+/* Timeouts in microseconds for the next start bit; 0 waits forever */
+int softuart_getc(struct softuart *u, unsigned int timeout_us);   /* Byte or error */
+unsigned int softuart_read(struct softuart *u, unsigned char *buf, unsigned int n,
+                           unsigned int timeout_us);              /* Bytes received */
+
+#endif /* SOFTUART_H */
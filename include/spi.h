@@ -0,0 +1,48 @@
+#ifndef SPI_H
+#define SPI_H
+
+/*
+ * DTEK-V Bit-Banged SPI Master
+ * Any four GPIO pins, all four clock modes, mcycle-paced edges
+ *
+ * Each clock edge is one port write; when SCK and MOSI share a bank the
+ * data bit and the clock change in the same store. Edges are paced against
+ * absolute mcycle deadlines, so the rate does not drift with the work done
+ * per bit. A rate of 0 runs as fast as the core can toggle the pins.
+ * Interrupts may stretch a clock phase but never corrupt a transfer.
+ */
+
+#define SPI_NO_PIN 0xFF             /* For an unused MISO, MOSI or CS */
+
+/* Clock modes: CPOL = bit 1 (idle level), CPHA = bit 0 (sample edge) */
+#define SPI_MODE0 0                 /* Idle low, sample on rising edge */
+#define SPI_MODE1 1                 /* Idle low, sample on falling edge */
+#define SPI_MODE2 2                 /* Idle high, sample on falling edge */
+#define SPI_MODE3 3                 /* Idle high, sample on rising edge */
+
+#define SPI_LSB_FIRST 0x4           /* Flag for spi_init() mode */
+
+struct spi_bus {
+    unsigned char sck, mosi, miso, cs;
+    unsigned char mode;
+    unsigned char sck_bank, mosi_bank, miso_bank;
+    unsigned int sck_mask, mosi_mask, miso_mask;
+    unsigned int half_period;       /* Cycles per clock phase, 0 = no pacing */
+};
+
+/* Pins are GPIO numbers 0-39; returns 0, or -1 on a bad pin or mode */
+int spi_init(struct spi_bus *bus, int sck, int mosi, int miso, int cs,
+             int mode, unsigned int hz);
+void spi_set_rate(struct spi_bus *bus, unsigned int hz);    /* 0 = fastest */
+
+/* Chip select (active low); a no-op without a CS pin */
+void spi_select(struct spi_bus *bus);
+void spi_deselect(struct spi_bus *bus);
+
+/* Transfers do not touch CS */
+unsigned char spi_transfer_byte(struct spi_bus *bus, unsigned char out);
+void spi_transfer(struct spi_bus *bus, unsigned char *buf, unsigned int n); /* In place */
+void spi_write(struct spi_bus *bus, const unsigned char *buf, unsigned int n);
+void spi_read(struct spi_bus *bus, unsigned char *buf, unsigned int n);     /* Sends 0xFF */
+
+#endif /* SPI_H */
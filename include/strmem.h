@@ -0,0 +1,27 @@
+#ifndef STRMEM_H
+#define STRMEM_H
+
+/*
+ * DTEK-V Memory and String Primitives
+ * Word-at-a-time implementations; GCC also calls memcpy/memset/memmove/
+ * memcmp implicitly for struct copies and large initializers
+ */
+
+#ifndef __SIZE_TYPE__
+#define __SIZE_TYPE__ unsigned int
+#endif
+typedef __SIZE_TYPE__ size_t;
+
+/* Memory blocks */
+void *memcpy(void *dest, const void *src, size_t n);
+void *memmove(void *dest, const void *src, size_t n);
+void *memset(void *dest, int c, size_t n);
+int memcmp(const void *s1, const void *s2, size_t n);
+
+/* Strings */
+int strlen(const char *s);
+int strcmp(const char *s1, const char *s2);
+void strcpy(char *dest, const char *src);
+void strcat(char *dest, const char *src);
+
+#endif /* STRMEM_H */
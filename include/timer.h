@@ -0,0 +1,55 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+/*
+ * DTEK-V Software Timers
+ * Any number of one-shot and periodic timers on the single hardware timer
+ *
+ * Armed timers are kept in a binary min-heap ordered by their mcycle
+ * deadline, so start and cancel are O(log n) and finding the next
+ * deadline is O(1). The hardware timer either ticks at a fixed rate
+ * (TIMER_MODE_TICK) or is reprogrammed to fire exactly at the next
+ * deadline (TIMER_MODE_TICKLESS).
+ *
+ * Callbacks run in interrupt context; keep them short.
+ */
+
+/* Maximum number of simultaneously armed timers */
+#ifndef TIMER_MAX
+#define TIMER_MAX 32
+#endif
+
+/* Tick period for TIMER_MODE_TICK, in microseconds */
+#ifndef TIMER_TICK_US
+#define TIMER_TICK_US 1000
+#endif
+
+/* Modes for timer_service_init() */
+#define TIMER_MODE_TICK     0   /* Fixed-rate hardware tick */
+#define TIMER_MODE_TICKLESS 1   /* One-shot, reprogrammed to the next deadline */
+
+struct soft_timer;
+typedef void (*soft_timer_fn)(struct soft_timer *timer, void *ctx);
+
+struct soft_timer {
+    unsigned long long deadline;    /* mcycle value at expiry */
+    unsigned long long period;      /* Reload in cycles, 0 for one-shot */
+    soft_timer_fn callback;
+    void *ctx;
+    int heap_index;                 /* Position in the heap, -1 if idle */
+};
+
+/* Service */
+void timer_service_init(int mode);  /* Take over the hardware timer */
+int timer_service_isr(void);        /* Called for IRQ_TIMER, 0 if inactive */
+int timer_service_mode(void);       /* Mode in use, -1 before init */
+
+/* Timers */
+void soft_timer_init(struct soft_timer *t, soft_timer_fn callback, void *ctx);
+int soft_timer_start(struct soft_timer *t, unsigned int delay_us, unsigned int period_us);
+int soft_timer_start_cycles(struct soft_timer *t, unsigned long long delay,
+                            unsigned long long period);
+void soft_timer_cancel(struct soft_timer *t);
+int soft_timer_active(const struct soft_timer *t);
+
+#endif /* TIMER_H */
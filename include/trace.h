@@ -0,0 +1,101 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+ * DTEK-V Trace Probes
+ * Cycle-stamped begin/end/value events in a RAM ring buffer
+ *
+ * TRACE_BEGIN(id) and TRACE_END(id) bracket a span of code and
+ * TRACE_VALUE(id, v) samples a counter. Each probe stores one fixed-size
+ * record (mcycle, id and kind, payload) at the head of the ring with
+ * interrupts briefly masked, so probes may be used from interrupt
+ * handlers and main alike. Once the ring is full the oldest records are
+ * overwritten. Without -DTRACE_ENABLE (`make TRACE=1`) the probes
+ * compile to nothing.
+ *
+ * IDs below TRACE_ID_USER are reserved: irq_dispatch() traces every
+ * interrupt as a span with its cause as the ID. IDs are 16 bits.
+ *
+ * Dump format (little-endian), sent by trace_dump():
+ *
+ *   bytes 0-3    TRACE_MAGIC "DTR1"
+ *   bytes 4-7    CPU clock in Hz
+ *   bytes 8-11   number of records
+ *   bytes 12-15  records lost to overwriting
+ *   then         per record, oldest first: 4-byte mcycle,
+ *                2-byte ID, 2-byte kind, 4-byte payload
+ *
+ * scripts/trace_json.py converts a dump to Chrome trace JSON for
+ * chrome://tracing or Perfetto.
+ */
+
+#define TRACE_MAGIC 0x31525444  /* "DTR1" */
+
+/* Records in the ring (12 bytes each); must be a power of two */
+#ifndef TRACE_MAX_RECORDS
+#define TRACE_MAX_RECORDS 1024
+#endif
+
+/* Record kinds */
+#define TRACE_KIND_BEGIN 0
+#define TRACE_KIND_END   1
+#define TRACE_KIND_VALUE 2
+
+/* First ID free for the application; lower ones are interrupt causes */
+#define TRACE_ID_USER 32
+
+struct trace_record {
+    unsigned int time;          /* mcycle */
+    unsigned short id;
+    unsigned short kind;
+    unsigned int value;         /* TRACE_VALUE payload, 0 otherwise */
+};
+
+#ifdef TRACE_ENABLE
+
+#include "atomic.h"
+#include "csr.h"
+
+extern struct trace_record trace_ring[TRACE_MAX_RECORDS];
+extern unsigned int trace_head;     /* Records written, wraps around */
+extern volatile int trace_on;
+
+/* Store one record; use the TRACE_* macros instead of calling directly */
+static inline void trace_emit(unsigned int id, unsigned int kind, unsigned int value) {
+    if (!trace_on)
+        return;
+    unsigned int s = irq_save();
+    struct trace_record *r = &trace_ring[trace_head++ & (TRACE_MAX_RECORDS - 1)];
+    r->time = csr_read(mcycle);
+    r->id = id;
+    r->kind = kind;
+    r->value = value;
+    irq_restore(s);
+}
+
+#define TRACE_BEGIN(id)    trace_emit((id), TRACE_KIND_BEGIN, 0)
+#define TRACE_END(id)      trace_emit((id), TRACE_KIND_END, 0)
+#define TRACE_VALUE(id, v) trace_emit((id), TRACE_KIND_VALUE, (v))
+
+#else
+
+#define TRACE_BEGIN(id)    ((void)0)
+#define TRACE_END(id)      ((void)0)
+#define TRACE_VALUE(id, v) ((void)0)
+
+#endif
+
+/*
+ * Control; recording is on from start-up. Stopping freezes the ring, e.g.
+ * right after a latency spike, so the events leading to it can be dumped.
+ * Without TRACE_ENABLE these do nothing and the dump is empty.
+ */
+void trace_start(void);
+void trace_stop(void);
+void trace_clear(void);
+unsigned int trace_count(void);     /* Records in the ring */
+
+/* Binary dump over the JTAG UART; pauses recording while sending */
+void trace_dump(void);
+
+#endif /* TRACE_H */
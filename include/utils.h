@@ -6,8 +6,23 @@
  * Debug and diagnostic tools
  */
 
+/* Variable argument lists (compiler builtins, valid at any -O level) */
+#ifndef va_start
+typedef __builtin_va_list va_list;
+#define va_start(ap, last) __builtin_va_start(ap, last)
+#define va_arg(ap, type)   __builtin_va_arg(ap, type)
+#define va_end(ap)         __builtin_va_end(ap)
+#define va_copy(dst, src)  __builtin_va_copy(dst, src)
+#endif
+
+/* Size of the stack buffer printf() formats into before each UART write */
+#ifndef PRINTF_BUF_SIZE
+#define PRINTF_BUF_SIZE 128
+#endif
+
 /* Printf-style formatted output */
 void printf(const char *format, ...);
+void vprintf(const char *format, va_list args);
 
 /* Memory dump utilities */
 void mem_dump(unsigned int address, unsigned int length);
@@ -21,20 +36,29 @@ void reg_dump_timer(void);
 void reg_dump_switches(void);
 void reg_dump_all(void);
 
-/* String utilities */
-int strlen(const char *s);
-int strcmp(const char *s1, const char *s2);
-void strcpy(char *dest, const char *src);
-void strcat(char *dest, const char *src);
+/* String utilities (strlen, strcmp, strcpy, strcat, mem*) */
+#include "strmem.h"
 
 /* String formatting helpers */
 int snprintf(char *buf, int size, const char *format, ...);
+int vsnprintf(char *buf, int size, const char *format, va_list args);
 void itoa(int value, char *str, int base);
 void utoa(unsigned int value, char *str, int base);
 
 /* Timing utilities */
-unsigned int get_cycles(void);
-unsigned int get_time_ms(void);
+#ifndef CPU_CLOCK_HZ
+#define CPU_CLOCK_HZ 30000000               /* Core clock, set with -DCPU_CLOCK_HZ */
+#endif
+
+unsigned int get_cycles(void);              /* Low 32 bits of mcycle */
+unsigned long long get_cycles64(void);      /* Full 64-bit mcycle */
+unsigned long long get_time_us(void);       /* Microseconds since reset */
+unsigned int get_time_ms(void);             /* Milliseconds since reset */
+unsigned long long cycles_to_us(unsigned long long cycles);
+unsigned long long cycles_to_ms(unsigned long long cycles);
+unsigned long long us_to_cycles(unsigned long long us);
+void sleep_cycles(unsigned long long cycles);
+void sleep_us(unsigned int us);
 void sleep_ms(unsigned int ms);
 
 /* Assert macro for debugging */
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""
+Compare DTEK-V benchmark reports (see bench/bench_suite.c).
+
+Reads the @bench lines from captured runner output; everything else in
+the capture is ignored. With one file the report is printed as a table.
+With two, the second is compared against the first (the baseline) and
+kernels whose median got slower by more than the threshold are flagged;
+the exit status is 1 if there are any.
+
+Usage:
+    dtekv-run build/bench.bin > baseline.txt
+    ... change the library, rebuild ...
+    dtekv-run build/bench.bin > current.txt
+    scripts/bench_compare.py baseline.txt current.txt --threshold 5
+"""
+
+import argparse
+import sys
+
+FIELDS = ("min", "median", "max")
+
+
+def parse(path):
+    """Return (header dict, {name: record dict}) from the last report in path."""
+    header, kernels, inside = {}, {}, False
+    with open(path, errors="replace") as f:
+        for line in f:
+            words = line.split()
+            if not words:
+                continue
+            tag, pairs = words[0], dict(w.split("=", 1) for w in words[1:] if "=" in w)
+            if tag == "@bench-begin":
+                header, kernels, inside = pairs, {}, True
+            elif tag == "@bench-end":
+                inside = False
+            elif tag == "@bench" and inside:
+                record = {k: int(pairs[k]) for k in FIELDS}
+                record["cpi"] = float(pairs["cpi"])
+                record["nominal"] = int(pairs.get("nominal", 0))
+                kernels[pairs["name"]] = record
+    if not kernels:
+        sys.exit(f"{path}: no benchmark report found")
+    if inside:
+        print(f"warning: {path}: report truncated", file=sys.stderr)
+    return header, kernels
+
+
+def show(kernels):
+    print(f"{'kernel':<20} {'min':>8} {'median':>8} {'max':>8} {'cpi':>6}")
+    for name, r in kernels.items():
+        print(f"{name:<20} {r['min']:>8} {r['median']:>8} {r['max']:>8} {r['cpi']:>6.2f}")
+
+
+def compare(base, cur, threshold, min_cycles):
+    """Print the median and CPI changes; return the names that regressed."""
+    regressed = []
+    print(f"{'kernel':<20} {'base':>8} {'now':>8} {'change':>9} {'cpi':>14}")
+    for name in list(base) + [n for n in cur if n not in base]:
+        if name not in cur:
+            print(f"{name:<20} {'':>8} {'':>8} {'removed':>9}")
+            continue
+        if name not in base:
+            print(f"{name:<20} {'':>8} {cur[name]['median']:>8} {'new':>9}")
+            continue
+        b, c = base[name], cur[name]
+        delta = c["median"] - b["median"]
+        # Medians are reported relative to the nominal time, e.g. for delays
+        scale = abs(b["median"] + b["nominal"]) or 1
+        pct = 100.0 * delta / scale
+        mark = ""
+        if delta > min_cycles and pct > threshold:
+            regressed.append(name)
+            mark = "  <- slower"
+        elif -delta > min_cycles and -pct > threshold:
+            mark = "  faster"
+        print(f"{name:<20} {b['median']:>8} {c['median']:>8} {pct:>+8.1f}% "
+              f"{b['cpi']:>5.2f} -> {c['cpi']:<5.2f}{mark}")
+    return regressed
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    ap.add_argument("baseline", help="captured runner output")
+    ap.add_argument("current", nargs="?", help="captured output to compare")
+    ap.add_argument("--threshold", type=float, default=5.0,
+                    help="percent change in the median to flag (default 5)")
+    ap.add_argument("--min-cycles", type=int, default=2,
+                    help="ignore changes of at most this many cycles (default 2)")
+    args = ap.parse_args()
+
+    base_header, base = parse(args.baseline)
+    if args.current is None:
+        show(base)
+        return 0
+
+    cur_header, cur = parse(args.current)
+    for key in ("version", "clock"):
+        if base_header.get(key) != cur_header.get(key):
+            print(f"warning: {key} differs: {base_header.get(key)} vs {cur_header.get(key)}",
+                  file=sys.stderr)
+    regressed = compare(base, cur, args.threshold, args.min_cycles)
+    if regressed:
+        print(f"\n{len(regressed)} kernel(s) slower: {', '.join(regressed)}")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
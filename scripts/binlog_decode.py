@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""
+Decode a DTEK-V binary log stream (see include/binlog.h).
+
+Format strings are read from the .binlog_fmt section of the firmware ELF.
+Plain text printed with print()/printf() in the same stream is passed
+through unchanged.
+
+Usage:
+    dtekv-run build/main.bin | scripts/binlog_decode.py
+    scripts/binlog_decode.py --elf build/main.elf capture.bin
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+BINLOG_MAGIC = 0xA5
+BINLOG_MAX_ARGS = 8
+HEADER_SIZE = 8
+
+
+def read_section(elf_path, name):
+    """Return the raw contents of an ELF32 section."""
+    with open(elf_path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF" or data[4] != 1:
+        sys.exit(f"{elf_path}: not an ELF32 file")
+
+    e_shoff, = struct.unpack_from("<I", data, 0x20)
+    e_shentsize, e_shnum, e_shstrndx = struct.unpack_from("<HHH", data, 0x2E)
+
+    def header(i):
+        return struct.unpack_from("<IIIIIIIIII", data, e_shoff + i * e_shentsize)
+
+    strtab = header(e_shstrndx)
+    for i in range(e_shnum):
+        sh = header(i)
+        start = strtab[4] + sh[0]
+        sec_name = data[start:data.index(b"\0", start)].decode()
+        if sec_name == name:
+            return data[sh[4]:sh[4] + sh[5]]
+    sys.exit(f"{elf_path}: no {name} section (was BINLOG() used?)")
+
+
+CONV = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\d+))?(hh|h|ll|l)?([diuxXobcsp%])")
+
+
+def digits_text(digits, flags, width, prec, alt_zero=False):
+    """Apply C precision, width and flags to the digits of %o or %b."""
+    if prec is not None:
+        digits = "" if prec == "0" and digits == "0" else digits.zfill(int(prec))
+    if alt_zero and not digits.startswith("0"):
+        digits = "0" + digits               # %#o; Python's %#o would print 0o
+    width = int(width or 0)
+    if "-" in flags:
+        return digits.ljust(width)
+    if "0" in flags and prec is None:
+        return digits.zfill(width)
+    return digits.rjust(width)
+
+
+def format_record(fmt, args):
+    """Apply a C printf format to 32-bit raw arguments."""
+    it = iter(args)
+
+    def arg():
+        return next(it, 0)
+
+    def repl(m):
+        flags, width, prec, length, conv = m.groups()
+        if conv == "%":
+            return "%"
+        if width == "*":
+            width = str(arg())
+        spec = "%" + flags + (width or "") + ("." + prec if prec else "")
+        v = arg()
+        if conv in "di":
+            if v & 0x80000000:
+                v -= 1 << 32
+            return (spec + "d") % v
+        if conv == "u":
+            return (spec + "d") % v
+        if conv in "xX":
+            return (spec + conv) % v
+        if conv == "o":
+            return digits_text(format(v, "o"), flags, width, prec, "#" in flags)
+        if conv == "b":
+            return digits_text(format(v, "b"), flags, width, prec)
+        if conv == "c":
+            return (spec + "c") % chr(v & 0xFF)
+        if conv == "p":
+            return "0x%08x" % v
+        return "<str@0x%08x>" % v  # %s: target pointer, not decodable
+
+    return CONV.sub(repl, fmt)
+
+
+def check_formats(fmts, elf_path):
+    """Exit on formats the 32-bit argument words cannot carry."""
+    for raw in fmts.split(b"\0"):
+        fmt = raw.decode(errors="replace")
+        if any(m.group(4) == "ll" for m in CONV.finditer(fmt)):
+            sys.exit(f"{elf_path}: BINLOG format {fmt!r} uses an ll conversion; "
+                     "arguments are sent as one 32-bit word each")
+
+
+def decode(stream, fmts, out, hz):
+    buf = stream
+    i = 0
+    text = bytearray()
+    while i < len(buf):
+        b = buf[i]
+        if b == BINLOG_MAGIC and i + HEADER_SIZE <= len(buf):
+            _, nargs, fid, ts = struct.unpack_from("<BBHI", buf, i)
+            end = i + HEADER_SIZE + 4 * nargs
+            valid_id = fid < len(fmts) and (fid == 0 or fmts[fid - 1] == 0)
+            if nargs <= BINLOG_MAX_ARGS and valid_id and end <= len(buf):
+                if text:
+                    out.write(text.decode(errors="replace"))
+                    text.clear()
+                args = struct.unpack_from("<%dI" % nargs, buf, i + HEADER_SIZE)
+                fmt = fmts[fid:fmts.index(b"\0", fid)].decode(errors="replace")
+                stamp = "%12.3f us" % (ts * 1e6 / hz) if hz else "%10u" % ts
+                msg = format_record(fmt, args)
+                out.write("[%s] %s%s" % (stamp, msg, "" if msg.endswith("\n") else "\n"))
+                i = end
+                continue
+        text.append(b)
+        i += 1
+    if text:
+        out.write(text.decode(errors="replace"))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("capture", nargs="?", help="captured UART bytes (default: stdin)")
+    ap.add_argument("--elf", default="build/main.elf", help="firmware ELF")
+    ap.add_argument("--hz", type=float, default=0,
+                    help="CPU clock to print timestamps in microseconds (e.g. 30e6)")
+    args = ap.parse_args()
+
+    fmts = read_section(args.elf, ".binlog_fmt")
+    check_formats(fmts, args.elf)
+    if args.capture:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    decode(data, fmts, sys.stdout, args.hz)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""
+Symbolize a DTEK-V crash record (see include/crash.h).
+
+Text printed around the record in the same stream, such as the readable
+summary the crash handler prints first, is skipped. Addresses are
+resolved against the firmware ELF; the disassembly the Makefile writes
+next to it (main.elf.txt) adds the faulting instruction, and is also
+used for the symbols if the ELF is missing. The last record in the
+capture is shown, as a restarted board may have crashed more than once.
+
+Usage:
+    dtekv-run build/main.bin > capture.bin
+    scripts/crash_report.py capture.bin
+    scripts/crash_report.py capture.bin --elf build/main.elf
+"""
+
+import argparse
+import bisect
+import os
+import re
+import struct
+import sys
+
+CRASH_MAGIC = 0x31524344
+FIXED_WORDS = 8 + 32 + 1 + 1    # Header, registers, depth, checksum
+
+CAUSES = {
+    0: "instruction address misaligned", 1: "instruction access fault",
+    2: "illegal instruction", 3: "breakpoint", 4: "load address misaligned",
+    5: "load access fault", 6: "store address misaligned", 7: "store access fault",
+}
+ABI = ["zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2", "s0", "s1", "a0", "a1",
+       "a2", "a3", "a4", "a5", "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+       "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"]
+
+# Linker-script markers that share an address with real code
+LINKER_SYMBOLS = {"_text_begin", "_text_end"}
+
+
+def parse(data):
+    """Return the last valid crash record in data as a dict."""
+    found, pos = None, 0
+    magic = struct.pack("<I", CRASH_MAGIC)
+    while True:
+        start = data.find(magic, pos)
+        if start < 0:
+            break
+        pos = start + 1
+        if start + 8 > len(data):
+            continue
+        size, = struct.unpack_from("<I", data, start + 4)
+        words = size // 4
+        if size % 4 or words <= FIXED_WORDS or start + size > len(data):
+            continue
+        w = struct.unpack_from(f"<{words}I", data, start)
+        if sum(w) & 0xFFFFFFFF:
+            print(f"warning: record at byte {start} fails its checksum", file=sys.stderr)
+            continue
+        depth = w[40]
+        found = dict(mcause=w[2], mtval=w[3], mepc=w[4], mstatus=w[5], cycles=w[6],
+                     count=w[7], regs=list(w[8:40]),
+                     backtrace=list(w[41:41 + min(depth, words - FIXED_WORDS)]))
+    if found is None:
+        sys.exit("no crash record found")
+    return found
+
+
+def elf_symbols(path):
+    """Return ([(address, name)] of the code symbols, end of text or None)."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF" or data[4] != 1:
+        sys.exit(f"{path}: not an ELF32 file")
+
+    e_shoff, = struct.unpack_from("<I", data, 0x20)
+    e_shentsize, e_shnum = struct.unpack_from("<HH", data, 0x2E)
+
+    def header(i):
+        return struct.unpack_from("<IIIIIIIIII", data, e_shoff + i * e_shentsize)
+
+    symbols, text_end = [], None
+    for i in range(e_shnum):
+        sh = header(i)
+        if sh[1] != 2:                          # SHT_SYMTAB
+            continue
+        strtab = header(sh[6])
+        for off in range(sh[4], sh[4] + sh[5], 16):
+            name_off, value, _, info, _, shndx = struct.unpack_from("<IIIBBH", data, off)
+            kind = info & 0xF
+            if kind not in (0, 2) or shndx == 0 or shndx >= 0xFF00:    # NOTYPE, FUNC
+                continue
+            start = strtab[4] + name_off
+            name = data[start:data.index(b"\0", start)].decode(errors="replace")
+            if name == "_text_end":
+                text_end = value
+            if name and not name.startswith((".L", "$")) and name not in LINKER_SYMBOLS:
+                symbols.append((value, kind != 2, name))
+    if not symbols:
+        sys.exit(f"{path}: no symbol table (stripped?)")
+
+    # Prefer a function over a plain label at the same address
+    symbols.sort()
+    table = []
+    for value, _, name in symbols:
+        if not table or table[-1][0] != value:
+            table.append((value, name))
+    return table, text_end
+
+
+LABEL = re.compile(r"^([0-9a-f]+) <(.+)>:$")
+INSN = re.compile(r"^\s*([0-9a-f]+):\t[0-9a-f ]+\t(.*)$")
+
+
+def read_disassembly(path):
+    """Return ([(address, name)], {address: instruction}) from objdump -D output."""
+    labels, insns, in_text = [], {}, False
+    with open(path, errors="replace") as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if line.startswith("Disassembly of section"):
+                in_text = line.endswith(" .text:")
+                continue
+            if not in_text:
+                continue
+            m = LABEL.match(line)
+            if m:
+                if m.group(2) not in LINKER_SYMBOLS:
+                    labels.append((int(m.group(1), 16), m.group(2)))
+                continue
+            m = INSN.match(line)
+            if m:
+                insns[int(m.group(1), 16)] = m.group(2).replace("\t", " ").strip()
+    return labels, insns
+
+
+class Symbolizer:
+    def __init__(self, table, end):
+        self.addrs = [a for a, _ in table]
+        self.names = [n for _, n in table]
+        self.end = end
+
+    def lookup(self, addr):
+        """Return 'name+0xoff' for an address in the text section, else ''."""
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0 or (self.end is not None and addr >= self.end):
+            return ""
+        offset = addr - self.addrs[i]
+        return f"{self.names[i]}+0x{offset:x}" if offset else self.names[i]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("capture", nargs="?", help="captured UART bytes (default: stdin)")
+    ap.add_argument("--elf", default="build/main.elf", help="firmware ELF")
+    ap.add_argument("--disasm", help="objdump -D output (default: ELF path + .txt)")
+    args = ap.parse_args()
+
+    if args.capture:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    r = parse(data)
+
+    disasm = args.disasm or args.elf + ".txt"
+    labels, insns = read_disassembly(disasm) if os.path.exists(disasm) else ([], {})
+    text_end = max(insns) + 4 if insns else None
+    if os.path.exists(args.elf):
+        table, elf_end = elf_symbols(args.elf)
+        sym = Symbolizer(table, elf_end or text_end)
+    elif labels:
+        sym = Symbolizer(labels, text_end)
+    else:
+        sys.exit(f"{args.elf}: not found, and no disassembly to take symbols from")
+
+    cause = CAUSES.get(r["mcause"], "unknown exception")
+    print(f"Crash #{r['count']}: {cause} (mcause={r['mcause']}) at cycle {r['cycles']}")
+    print(f"  pc     {r['mepc']:08x}  {sym.lookup(r['mepc'])}")
+    if r["mepc"] in insns:
+        print(f"         {insns[r['mepc']]}")
+    if r["mcause"] in (4, 5, 6, 7):
+        print(f"  address {r['mtval']:08x}")
+    elif r["mcause"] == 2:
+        print(f"  instruction {r['mtval']:08x}")
+    else:
+        print(f"  mtval  {r['mtval']:08x}")
+    mpie = r["mstatus"] >> 7 & 1
+    print(f"  mstatus {r['mstatus']:08x} (interrupts were {'on' if mpie else 'off'})")
+
+    print("\nRegisters:")
+    for n, value in enumerate(r["regs"]):
+        print(f"  x{n:<2} {ABI[n]:<4} {value:08x}  {sym.lookup(value) if value else ''}")
+
+    # Return addresses from ra and a stack scan, shown at their call sites;
+    # a stale one from an earlier call can sit between two real callers
+    print("\nBacktrace (call sites, from a stack scan):")
+    print(f"  #0 {r['mepc']:08x}  {sym.lookup(r['mepc'])}")
+    for i, addr in enumerate(r["backtrace"], 1):
+        print(f"  #{i} {addr - 4:08x}  {sym.lookup(addr - 4) or '?'}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
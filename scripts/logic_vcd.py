@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Convert a DTEK-V logic analyzer dump (see include/logic.h) to VCD.
+
+Text printed before the dump in the same stream is skipped. Only pins
+that change during the capture are written unless --pins is given. A
+"trigger" signal pulses high at the trigger record.
+
+Usage:
+    dtekv-run build/main.bin > capture.bin
+    scripts/logic_vcd.py capture.bin -o capture.vcd
+    scripts/logic_vcd.py capture.bin --pins 0-3,20 --name 0=SCK --name 1=MOSI
+"""
+
+import argparse
+import struct
+import sys
+
+LOGIC_MAGIC = 0x31414C44
+HEADER = struct.Struct("<7I")
+RECORD_SIZE = 9
+PIN_COUNT = 40
+
+
+def parse(data):
+    """Return (header dict, [(time, pins)]) from the first dump in data."""
+    start = data.find(struct.pack("<I", LOGIC_MAGIC))
+    if start < 0 or start + HEADER.size > len(data):
+        sys.exit("no logic analyzer dump found")
+    _, hz, interval, count, trigger, end, samples = HEADER.unpack_from(data, start)
+    body = start + HEADER.size
+    avail = (len(data) - body) // RECORD_SIZE
+    if avail < count:
+        print(f"warning: dump truncated, {avail} of {count} records", file=sys.stderr)
+        count = avail
+
+    records = []
+    for i in range(count):
+        time, lo, hi = struct.unpack_from("<IIB", data, body + i * RECORD_SIZE)
+        records.append((time, lo | (hi << 32)))
+    return dict(hz=hz, interval=interval, trigger=trigger, end=end,
+                samples=samples), records
+
+
+def parse_pins(spec):
+    pins = []
+    for part in spec.split(","):
+        if "-" in part:
+            lo, hi = part.split("-")
+            pins.extend(range(int(lo), int(hi) + 1))
+        else:
+            pins.append(int(part))
+    return pins
+
+
+def identifier(i):
+    """Short VCD identifier from printable ASCII."""
+    chars = ""
+    i += 1
+    while i:
+        i, r = divmod(i - 1, 94)
+        chars = chr(33 + r) + chars
+    return chars
+
+
+def write_vcd(out, info, records, pins, names):
+    hz = info["hz"] or 1
+    ns_per_cycle = 1e9 / hz
+
+    def stamp(cycles):
+        return int(round(cycles * ns_per_cycle))
+
+    out.write("$comment DTEK-V logic analyzer, %u samples, %s $end\n" % (
+        info["samples"],
+        "interval %u cycles" % info["interval"] if info["interval"] else "free-running"))
+    out.write("$timescale 1 ns $end\n$scope module dtekv $end\n")
+    ids = {}
+    for n, pin in enumerate(pins):
+        ids[pin] = identifier(n)
+        out.write("$var wire 1 %s %s $end\n" % (ids[pin], names.get(pin, "gpio%d" % pin)))
+    trig_id = identifier(len(pins))
+    out.write("$var wire 1 %s trigger $end\n" % trig_id)
+    out.write("$upscope $end\n$enddefinitions $end\n")
+
+    prev = None
+    prev_trig = 0
+    for i, (time, levels) in enumerate(records):
+        out.write("#%d\n" % stamp(time))
+        if prev is None:
+            out.write("$dumpvars\n")
+        for pin in pins:
+            bit = (levels >> pin) & 1
+            if prev is None or ((prev >> pin) & 1) != bit:
+                out.write("%d%s\n" % (bit, ids[pin]))
+        trig = 1 if i == info["trigger"] else 0
+        if prev is None or trig != prev_trig:
+            out.write("%d%s\n" % (trig, trig_id))
+        prev_trig = trig
+        if prev is None:
+            out.write("$end\n")
+        prev = levels
+    if records and stamp(info["end"]) > stamp(records[-1][0]):
+        out.write("#%d\n" % stamp(info["end"]))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("capture", nargs="?", help="captured UART bytes (default: stdin)")
+    ap.add_argument("-o", "--output", help="VCD file (default: stdout)")
+    ap.add_argument("--pins", help="pins to include, e.g. 0-7,20 (default: pins that change)")
+    ap.add_argument("--name", action="append", default=[], metavar="PIN=NAME",
+                    help="signal name for a pin (repeatable)")
+    args = ap.parse_args()
+
+    if args.capture:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    info, records = parse(data)
+
+    if args.pins:
+        pins = parse_pins(args.pins)
+    else:
+        changed = 0
+        for (_, a), (_, b) in zip(records, records[1:]):
+            changed |= a ^ b
+        pins = [p for p in range(PIN_COUNT) if changed >> p & 1]
+    names = {}
+    for item in args.name:
+        pin, name = item.split("=", 1)
+        names[int(pin)] = name
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    write_vcd(out, info, records, pins, names)
+    if args.output:
+        out.close()
+        print("%d records, %d signals -> %s" % (len(records), len(pins), args.output),
+              file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
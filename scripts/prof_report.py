@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+"""
+Symbolize a DTEK-V profiler dump (see include/prof.h).
+
+Text printed before the dump in the same stream is skipped. Function
+symbols come from the firmware ELF; the disassembly the Makefile writes
+next to it (main.elf.txt) annotates the hottest addresses, and is also
+used for the symbols if the ELF is missing. Prints a flat profile, the
+hot addresses of the top functions and, for dumps taken with
+PROF_CALLERS, the functions the sampled code was called from.
+
+Usage:
+    dtekv-run build/main.bin > capture.bin
+    scripts/prof_report.py capture.bin
+    scripts/prof_report.py capture.bin --elf build/main.elf --top 10
+"""
+
+import argparse
+import bisect
+import os
+import re
+import struct
+import sys
+
+PROF_MAGIC = 0x31465044
+PROF_CALLERS = 0x1
+HEADER = struct.Struct("<11I")
+ENTRY = struct.Struct("<II")
+
+# Linker-script markers that share an address with real code
+LINKER_SYMBOLS = {"_text_begin", "_text_end"}
+
+
+def parse(data):
+    """Return (header dict, {bucket: count}, {bucket: count}) from the first dump."""
+    start = data.find(struct.pack("<I", PROF_MAGIC))
+    if start < 0 or start + HEADER.size > len(data):
+        sys.exit("no profiler dump found")
+    (_, hz, rate, base, shift, buckets, samples, outside, flags,
+     pc_entries, caller_entries) = HEADER.unpack_from(data, start)
+    pos = start + HEADER.size
+
+    def entries(count):
+        nonlocal pos
+        avail = (len(data) - pos) // ENTRY.size
+        if avail < count:
+            print(f"warning: dump truncated, {avail} of {count} entries", file=sys.stderr)
+            count = avail
+        hist = {}
+        for _ in range(count):
+            index, n = ENTRY.unpack_from(data, pos)
+            hist[index] = n
+            pos += ENTRY.size
+        return hist
+
+    pcs = entries(pc_entries)
+    callers = entries(caller_entries)
+    return dict(hz=hz, rate=rate, base=base, shift=shift, buckets=buckets,
+                samples=samples, outside=outside, flags=flags), pcs, callers
+
+
+def elf_symbols(path):
+    """Return [(address, name)] of the code symbols in an ELF32 file."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF" or data[4] != 1:
+        sys.exit(f"{path}: not an ELF32 file")
+
+    e_shoff, = struct.unpack_from("<I", data, 0x20)
+    e_shentsize, e_shnum = struct.unpack_from("<HH", data, 0x2E)
+
+    def header(i):
+        return struct.unpack_from("<IIIIIIIIII", data, e_shoff + i * e_shentsize)
+
+    symbols = []
+    for i in range(e_shnum):
+        sh = header(i)
+        if sh[1] != 2:                          # SHT_SYMTAB
+            continue
+        strtab = header(sh[6])
+        for off in range(sh[4], sh[4] + sh[5], 16):
+            name_off, value, _, info, _, shndx = struct.unpack_from("<IIIBBH", data, off)
+            kind = info & 0xF
+            if kind not in (0, 2) or shndx == 0 or shndx >= 0xFF00:    # NOTYPE, FUNC
+                continue
+            start = strtab[4] + name_off
+            name = data[start:data.index(b"\0", start)].decode(errors="replace")
+            if name and not name.startswith((".L", "$")) and name not in LINKER_SYMBOLS:
+                symbols.append((value, kind != 2, name))
+    if not symbols:
+        sys.exit(f"{path}: no symbol table (stripped?)")
+
+    # Prefer a function over a plain label at the same address
+    symbols.sort()
+    table = []
+    for value, _, name in symbols:
+        if not table or table[-1][0] != value:
+            table.append((value, name))
+    return table
+
+
+LABEL = re.compile(r"^([0-9a-f]+) <(.+)>:$")
+INSN = re.compile(r"^\s*([0-9a-f]+):\t[0-9a-f ]+\t(.*)$")
+
+
+def read_disassembly(path):
+    """Return ([(address, name)], {address: instruction}) from objdump -D output."""
+    labels, insns, in_text = [], {}, False
+    with open(path, errors="replace") as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if line.startswith("Disassembly of section"):
+                in_text = line.endswith(" .text:")
+                continue
+            if not in_text:
+                continue
+            m = LABEL.match(line)
+            if m:
+                if m.group(2) not in LINKER_SYMBOLS:
+                    labels.append((int(m.group(1), 16), m.group(2)))
+                continue
+            m = INSN.match(line)
+            if m:
+                insns[int(m.group(1), 16)] = m.group(2).replace("\t", " ").strip()
+    return labels, insns
+
+
+class Symbolizer:
+    def __init__(self, table):
+        self.addrs = [a for a, _ in table]
+        self.names = [n for _, n in table]
+
+    def lookup(self, addr):
+        """Return (name, offset) of the symbol at or before addr."""
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return "?", addr
+        return self.names[i], addr - self.addrs[i]
+
+
+def by_function(hist, info, sym):
+    """Sum bucket counts per function: {name: (count, [(addr, count)])}."""
+    funcs = {}
+    for index, count in hist.items():
+        addr = info["base"] + (index << info["shift"])
+        name, _ = sym.lookup(addr)
+        total, buckets = funcs.get(name, (0, []))
+        buckets.append((addr, count))
+        funcs[name] = (total + count, buckets)
+    return sorted(funcs.items(), key=lambda kv: -kv[1][0])
+
+
+def pct(count, total):
+    return 100.0 * count / total if total else 0.0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("capture", nargs="?", help="captured UART bytes (default: stdin)")
+    ap.add_argument("--elf", default="build/main.elf", help="firmware ELF")
+    ap.add_argument("--disasm", help="objdump -D output (default: ELF path + .txt)")
+    ap.add_argument("--top", type=int, default=5,
+                    help="functions to break down by address (default 5)")
+    ap.add_argument("--lines", type=int, default=8,
+                    help="hot addresses shown per function (default 8)")
+    args = ap.parse_args()
+
+    if args.capture:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    info, pcs, callers = parse(data)
+
+    disasm = args.disasm or args.elf + ".txt"
+    labels, insns = read_disassembly(disasm) if os.path.exists(disasm) else ([], {})
+    if os.path.exists(args.elf):
+        sym = Symbolizer(elf_symbols(args.elf))
+    elif labels:
+        sym = Symbolizer(labels)
+    else:
+        sys.exit(f"{args.elf}: not found, and no disassembly to take symbols from")
+
+    samples = info["samples"]
+    width = 1 << info["shift"]
+    seconds = samples / info["rate"] if info["rate"] else 0
+    print(f"{samples} samples at {info['rate']} Hz (~{seconds:.1f} s), "
+          f"{info['outside']} outside text, {width}-byte buckets")
+    if width > 4:
+        print("note: a bucket can straddle two functions; raise PROF_MAX_BUCKETS to narrow them")
+
+    funcs = by_function(pcs, info, sym)
+    print(f"\n{'samples':>8} {'%':>6} {'cum %':>6}  function")
+    cumulative = 0
+    for name, (count, _) in funcs:
+        cumulative += count
+        print(f"{count:>8} {pct(count, samples):>6.1f} {pct(cumulative, samples):>6.1f}  {name}")
+
+    for name, (count, buckets) in funcs[:args.top]:
+        print(f"\n{name}: {count} samples ({pct(count, samples):.1f}%)")
+        for addr, n in sorted(buckets, key=lambda b: -b[1])[:args.lines]:
+            _, offset = sym.lookup(addr)
+            code = [insns[a] for a in range(addr, addr + width, 4) if a in insns]
+            print(f"  {addr:08x} +0x{offset:<5x} {n:>8} {pct(n, count):>6.1f}%  "
+                  f"{' ; '.join(code)}")
+
+    if info["flags"] & PROF_CALLERS:
+        print(f"\n{'samples':>8} {'%':>6}  caller (function holding the interrupted ra)")
+        attributed = 0
+        for name, (count, _) in by_function(callers, info, sym):
+            attributed += count
+            print(f"{count:>8} {pct(count, samples):>6.1f}  {name}")
+        if samples > attributed:
+            print(f"{samples - attributed:>8} {pct(samples - attributed, samples):>6.1f}  "
+                  "(ra outside text)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""
+Convert a DTEK-V trace dump (see include/trace.h) to Chrome trace JSON.
+
+Text printed before the dump in the same stream is skipped. The output
+opens in chrome://tracing or https://ui.perfetto.dev. Spans become
+begin/end events and TRACE_VALUE records counters. Interrupts (IDs below
+32) go on an "interrupts" track and everything else on "main" unless a
+names file or --name puts them elsewhere. A summary of the span
+durations, with the longest one of each ID, is printed to stderr.
+
+Names file, one ID per line ("#" starts a comment):
+    32 main_loop
+    33 spi_transfer drivers
+    40 rx_level
+
+Usage:
+    dtekv-run build/main.bin > capture.bin
+    scripts/trace_json.py capture.bin -o trace.json --names trace_ids.txt
+    scripts/trace_json.py capture.bin --name 32=main_loop --name 33=spi@drivers
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+TRACE_MAGIC = 0x31525444
+TRACE_ID_USER = 32
+HEADER = struct.Struct("<4I")
+RECORD = struct.Struct("<IHHI")
+BEGIN, END, VALUE = 0, 1, 2
+
+IRQ_NAMES = {16: "timer", 17: "switches", 18: "button", 19: "jtag_uart"}
+
+
+def parse(data):
+    """Return (clock Hz, lost, [(cycles, id, kind, value)]) from the first dump."""
+    start = data.find(struct.pack("<I", TRACE_MAGIC))
+    if start < 0 or start + HEADER.size > len(data):
+        sys.exit("no trace dump found")
+    _, hz, count, lost = HEADER.unpack_from(data, start)
+    body = start + HEADER.size
+    avail = (len(data) - body) // RECORD.size
+    if avail < count:
+        print(f"warning: dump truncated, {avail} of {count} records", file=sys.stderr)
+        count = avail
+
+    # mcycle is 32 bits; records are in time order, so unwrap by the deltas
+    records, now, prev = [], 0, None
+    for i in range(count):
+        time, ident, kind, value = RECORD.unpack_from(data, body + i * RECORD.size)
+        if prev is not None:
+            now += (time - prev) & 0xFFFFFFFF
+        prev = time
+        records.append((now, ident, kind, value))
+    return hz, lost, records
+
+
+def default_name(ident):
+    if ident < TRACE_ID_USER:
+        return IRQ_NAMES.get(ident, f"irq{ident}"), "interrupts"
+    return f"id{ident}", "main"
+
+
+def parse_name(spec, names):
+    """ID=NAME[@TRACK]"""
+    ident, rest = spec.split("=", 1)
+    name, _, track = rest.partition("@")
+    ident = int(ident, 0)
+    names[ident] = (name, track or default_name(ident)[1])
+
+
+def read_names(path, names):
+    with open(path) as f:
+        for line in f:
+            words = line.split("#", 1)[0].split()
+            if not words:
+                continue
+            ident = int(words[0], 0)
+            name = words[1] if len(words) > 1 else default_name(ident)[0]
+            track = words[2] if len(words) > 2 else default_name(ident)[1]
+            names[ident] = (name, track)
+
+
+def convert(hz, records, names):
+    """Return (Chrome trace events, {id: [span durations in cycles]})."""
+    us_per_cycle = 1e6 / (hz or 1)
+    tracks, events, spans, open_at = {}, [], {}, {}
+
+    def tid(track):
+        if track not in tracks:
+            tracks[track] = len(tracks) + 1
+            events.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": tracks[track],
+                           "args": {"name": track}})
+        return tracks[track]
+
+    for cycles, ident, kind, value in records:
+        name, track = names.get(ident) or default_name(ident)
+        ts = round(cycles * us_per_cycle, 3)
+        if kind == VALUE:
+            events.append({"name": name, "ph": "C", "ts": ts, "pid": 1, "tid": tid(track),
+                           "args": {"value": value}})
+        elif kind == BEGIN:
+            open_at.setdefault(ident, []).append(cycles)
+            events.append({"name": name, "ph": "B", "ts": ts, "pid": 1, "tid": tid(track)})
+        elif kind == END:
+            # The begin may have been overwritten; Chrome needs them paired
+            if not open_at.get(ident):
+                continue
+            spans.setdefault(ident, []).append(cycles - open_at[ident].pop())
+            events.append({"name": name, "ph": "E", "ts": ts, "pid": 1, "tid": tid(track)})
+    return events, spans
+
+
+def summary(hz, lost, records, spans, names):
+    us_per_cycle = 1e6 / (hz or 1)
+    length = records[-1][0] - records[0][0] if records else 0
+    print(f"{len(records)} records ({lost} lost) over {length} cycles "
+          f"({length * us_per_cycle:.1f} us)", file=sys.stderr)
+    if not spans:
+        return
+    print(f"{'span':<20} {'count':>6} {'min':>9} {'mean':>9} {'max':>9}  (cycles)",
+          file=sys.stderr)
+    for ident, d in sorted(spans.items(), key=lambda kv: -max(kv[1])):
+        name = (names.get(ident) or default_name(ident))[0]
+        print(f"{name:<20} {len(d):>6} {min(d):>9} {sum(d) // len(d):>9} {max(d):>9}",
+              file=sys.stderr)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("capture", nargs="?", help="captured UART bytes (default: stdin)")
+    ap.add_argument("-o", "--output", help="JSON file (default: stdout)")
+    ap.add_argument("--names", help="file of 'ID NAME [TRACK]' lines")
+    ap.add_argument("--name", action="append", default=[], metavar="ID=NAME[@TRACK]",
+                    help="name and optional track for an ID (repeatable)")
+    args = ap.parse_args()
+
+    if args.capture:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    hz, lost, records = parse(data)
+
+    names = {}
+    if args.names:
+        read_names(args.names, names)
+    for spec in args.name:
+        parse_name(spec, names)
+
+    events, spans = convert(hz, records, names)
+    out = open(args.output, "w") if args.output else sys.stdout
+    json.dump({"traceEvents": events, "displayTimeUnit": "ns",
+               "otherData": {"clock_hz": hz, "lost_records": lost}}, out, indent=1)
+    out.write("\n")
+    summary(hz, lost, records, spans, names)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
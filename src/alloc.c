@@ -0,0 +1,167 @@
+#include "alloc.h"
+#include "atomic.h"
+#include "utils.h"
+
+/* Heap bounds from dtekv-script.lds */
+extern char _heap_begin[];
+extern char _heap_end[];
+
+#define ALIGN_UP(x) (((x) + ALLOC_ALIGN - 1) & ~(ALLOC_ALIGN - 1))
+
+/* ===== Heap Region ===== */
+
+static unsigned int heap_top;   /* Bytes handed out by heap_reserve() */
+
+void *heap_reserve(unsigned int size) {
+    void *ptr = 0;
+    size = ALIGN_UP(size);
+
+    unsigned int s = irq_save();
+    unsigned int start = ALIGN_UP((unsigned long)_heap_begin + heap_top) -
+                         (unsigned long)_heap_begin;
+    if (start + size <= heap_size()) {
+        ptr = _heap_begin + start;
+        heap_top = start + size;
+    }
+    irq_restore(s);
+    return ptr;
+}
+
+unsigned int heap_used(void) {
+    return heap_top;
+}
+
+unsigned int heap_size(void) {
+    return _heap_end - _heap_begin;
+}
+
+/* ===== Fixed-Block Pools ===== */
+
+int pool_init(struct pool *p, unsigned int block_size, unsigned int num_blocks) {
+    /* Each free block stores the next pointer in its first word */
+    if (block_size < sizeof(void *))
+        block_size = sizeof(void *);
+    block_size = ALIGN_UP(block_size);
+
+    char *mem = heap_reserve(block_size * num_blocks);
+    if (mem == 0)
+        return -1;
+
+    p->base = mem;
+    p->end = mem + block_size * num_blocks;
+    p->block_size = block_size;
+    p->num_blocks = num_blocks;
+    p->used = 0;
+    p->high_water = 0;
+
+    /* Thread the free list through the blocks in address order */
+    p->free_list = num_blocks ? mem : 0;
+    for (unsigned int i = 0; i < num_blocks; i++) {
+        char *block = mem + i * block_size;
+        *(void **)block = (i + 1 < num_blocks) ? block + block_size : 0;
+    }
+    return 0;
+}
+
+void *pool_alloc(struct pool *p) {
+    unsigned int s = irq_save();
+    void *block = p->free_list;
+    if (block) {
+        p->free_list = *(void **)block;
+        if (++p->used > p->high_water)
+            p->high_water = p->used;
+    }
+    irq_restore(s);
+    return block;
+}
+
+void pool_free(struct pool *p, void *block) {
+    if (block == 0)
+        return;
+    ASSERT((char *)block >= p->base && (char *)block < p->end);
+    ASSERT(((char *)block - p->base) % p->block_size == 0);
+
+    unsigned int s = irq_save();
+    *(void **)block = p->free_list;
+    p->free_list = block;
+    p->used--;
+    irq_restore(s);
+}
+
+/* ===== Size-Class Allocator ===== */
+
+static const unsigned short class_sizes[ALLOC_NUM_CLASSES] = ALLOC_CLASS_SIZES;
+static const unsigned short class_blocks[ALLOC_NUM_CLASSES] = ALLOC_CLASS_BLOCKS;
+static struct pool class_pools[ALLOC_NUM_CLASSES];
+static unsigned int class_failures[ALLOC_NUM_CLASSES];
+
+int alloc_init(void) {
+    for (int i = 0; i < ALLOC_NUM_CLASSES; i++) {
+        if (pool_init(&class_pools[i], class_sizes[i], class_blocks[i]) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+void *block_alloc(unsigned int size) {
+    for (int i = 0; i < ALLOC_NUM_CLASSES; i++) {
+        if (size <= class_sizes[i]) {
+            void *ptr = pool_alloc(&class_pools[i]);
+            if (ptr == 0)
+                class_failures[i]++;
+            return ptr;
+        }
+    }
+    return 0;
+}
+
+void block_free(void *ptr) {
+    /* The owning class is found from the address range of each pool */
+    for (int i = 0; i < ALLOC_NUM_CLASSES; i++) {
+        struct pool *p = &class_pools[i];
+        if ((char *)ptr >= p->base && (char *)ptr < p->end) {
+            pool_free(p, ptr);
+            return;
+        }
+    }
+    ASSERT(ptr == 0);
+}
+
+void alloc_report(void) {
+    printf("\n=== Heap: %u / %u bytes reserved ===\n", heap_used(), heap_size());
+    printf("class  blocks  used  peak  fails\n");
+    for (int i = 0; i < ALLOC_NUM_CLASSES; i++) {
+        struct pool *p = &class_pools[i];
+        printf("%5u  %6u  %4u  %4u  %5u\n", class_sizes[i], p->num_blocks, p->used,
+               p->high_water, class_failures[i]);
+    }
+}
+
+/* ===== Bump Arenas ===== */
+
+int arena_init(struct arena *a, unsigned int size) {
+    a->base = heap_reserve(size);
+    a->size = a->base ? ALIGN_UP(size) : 0;
+    a->used = 0;
+    a->high_water = 0;
+    return a->base ? 0 : -1;
+}
+
+void *arena_alloc(struct arena *a, unsigned int size) {
+    void *ptr = 0;
+    size = ALIGN_UP(size);
+
+    unsigned int s = irq_save();
+    if (a->used + size <= a->size) {
+        ptr = a->base + a->used;
+        a->used += size;
+        if (a->used > a->high_water)
+            a->high_water = a->used;
+    }
+    irq_restore(s);
+    return ptr;
+}
+
+void arena_reset(struct arena *a) {
+    a->used = 0;
+}
@@ -0,0 +1,22 @@
+#include "binlog.h"
+#include "dtekv-lib.h"
+#include "csr.h"
+
+/* ===== Binary Logger ===== */
+
+void binlog_emit(unsigned int id, const unsigned int *args, unsigned int nargs) {
+    unsigned int rec[2 + BINLOG_MAX_ARGS];
+
+    if (nargs > BINLOG_MAX_ARGS)
+        nargs = BINLOG_MAX_ARGS;
+
+    /* RV32 is little-endian, so whole words give the documented byte order */
+    rec[0] = BINLOG_MAGIC | (nargs << 8) | ((id & 0xFFFF) << 16);
+    rec[1] = csr_read(mcycle);
+    for (unsigned int i = 0; i < nargs; i++) {
+        rec[2 + i] = args[i];
+    }
+
+    /* One bulk write keeps the record contiguous even when ISRs log too */
+    uart_write((const char *)rec, (2 + nargs) * 4);
+}
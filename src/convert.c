@@ -0,0 +1,197 @@
+#include "convert.h"
+
+/* ===== Decimal Conversion ===== */
+
+/*
+ * rv32im has a single-cycle-issue mulhu but a slow, iterative divu, so
+ * all decimal paths divide by multiplying with a fixed-point reciprocal
+ * and emit two digits per step from a 200-byte table.
+ */
+
+static const char digit_pairs[200] = {
+    '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9',
+    '1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9',
+    '2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9',
+    '3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9',
+    '4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9',
+    '5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9',
+    '6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9',
+    '7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9',
+    '8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9',
+    '9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9',
+};
+
+static const char hex_lower[16] = "0123456789abcdef";
+static const char hex_upper[16] = "0123456789ABCDEF";
+
+/* x / 100 and x / 10 for any 32-bit x (compiles to mulhu + shift) */
+static inline unsigned int div100(unsigned int x) {
+    return (unsigned int)(((unsigned long long)x * 0x51EB851Fu) >> 37);
+}
+
+static inline unsigned int div10(unsigned int x) {
+    return (unsigned int)(((unsigned long long)x * 0xCCCCCCCDu) >> 35);
+}
+
+int u32_dec_digits(unsigned int value) {
+    if (value < 100000) {
+        if (value < 100)
+            return value < 10 ? 1 : 2;
+        if (value < 10000)
+            return value < 1000 ? 3 : 4;
+        return 5;
+    }
+    if (value < 10000000)
+        return value < 1000000 ? 6 : 7;
+    if (value < 1000000000)
+        return value < 100000000 ? 8 : 9;
+    return 10;
+}
+
+/* Write exactly len digits of value ending at buf[len - 1] */
+static void dec_fill(unsigned int value, char *buf, int len) {
+    char *p = buf + len;
+    while (len >= 2) {
+        unsigned int q = div100(value);
+        unsigned int r = value - q * 100;
+        p -= 2;
+        p[0] = digit_pairs[2 * r];
+        p[1] = digit_pairs[2 * r + 1];
+        value = q;
+        len -= 2;
+    }
+    if (len)
+        *--p = (char)('0' + (value - div10(value) * 10));
+}
+
+int u32_to_dec(unsigned int value, char *buf) {
+    int len = u32_dec_digits(value);
+    dec_fill(value, buf, len);
+    buf[len] = '\0';
+    return len;
+}
+
+int i32_to_dec(int value, char *buf) {
+    if (value < 0) {
+        buf[0] = '-';
+        return 1 + u32_to_dec(0u - (unsigned int)value, buf + 1);
+    }
+    return u32_to_dec((unsigned int)value, buf);
+}
+
+/* x / 10^9 for any 64-bit x: (x >> 9) / 5^9 by reciprocal multiply */
+static inline unsigned long long div1e9(unsigned long long x) {
+    return mulhi64(x >> 9, 0x89705F4136B4A6ULL) >> 12;
+}
+
+int u64_to_dec(unsigned long long value, char *buf) {
+    if ((value >> 32) == 0)
+        return u32_to_dec((unsigned int)value, buf);
+
+    /* Split into base-10^9 limbs: top (1-2 digits), mid and low (9 each) */
+    unsigned long long q = div1e9(value);
+    unsigned int low = (unsigned int)(value - q * 1000000000ULL);
+    unsigned int len;
+
+    if ((q >> 32) == 0 && (unsigned int)q < 1000000000) {
+        len = u32_to_dec((unsigned int)q, buf);
+    } else {
+        unsigned int top = (unsigned int)div1e9(q);
+        unsigned int mid = (unsigned int)(q - top * 1000000000ULL);
+        len = u32_to_dec(top, buf);
+        dec_fill(mid, buf + len, 9);
+        len += 9;
+    }
+    dec_fill(low, buf + len, 9);
+    len += 9;
+    buf[len] = '\0';
+    return len;
+}
+
+/* ===== Power-of-Two Bases ===== */
+
+int u32_to_hex(unsigned int value, char *buf, int digits, int upper) {
+    const char *tab = upper ? hex_upper : hex_lower;
+    int len = 1;
+    while (len < 8 && (value >> (4 * len)) != 0) {
+        len++;
+    }
+    if (digits > len)
+        len = digits > 8 ? 8 : digits;
+
+    for (int i = len - 1; i >= 0; i--) {
+        buf[i] = tab[value & 0xF];
+        value >>= 4;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+int u64_to_hex(unsigned long long value, char *buf, int digits, int upper) {
+    unsigned int hi = (unsigned int)(value >> 32);
+    if (hi == 0 && digits <= 8)
+        return u32_to_hex((unsigned int)value, buf, digits, upper);
+
+    int len = u32_to_hex(hi, buf, digits > 8 ? digits - 8 : 0, upper);
+    len += u32_to_hex((unsigned int)value, buf + len, 8, upper);
+    return len;
+}
+
+int u32_to_bin(unsigned int value, char *buf, int digits) {
+    int len = 1;
+    while (len < 32 && (value >> len) != 0) {
+        len++;
+    }
+    if (digits > len)
+        len = digits > 32 ? 32 : digits;
+
+    for (int i = len - 1; i >= 0; i--) {
+        buf[i] = (char)('0' + (value & 1));
+        value >>= 1;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+/* ===== Generic Base ===== */
+
+int u64_to_base(unsigned long long value, unsigned int base, char *buf, int upper) {
+    static const char alpha_lower[36] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    static const char alpha_upper[36] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+    if (base == 10)
+        return u64_to_dec(value, buf);
+    if (base == 16)
+        return u64_to_hex(value, buf, 0, upper);
+    if (base == 2 && (value >> 32) == 0)
+        return u32_to_bin((unsigned int)value, buf, 0);
+    if (base < 2 || base > 36) {
+        buf[0] = '\0';
+        return 0;
+    }
+
+    /* Remaining bases are rare: divide in 16-bit steps (no libgcc __udivdi3) */
+    const char *tab = upper ? alpha_upper : alpha_lower;
+    char tmp[CONV_BUF_SIZE];
+    int n = 0;
+    do {
+        unsigned int hi = (unsigned int)(value >> 32);
+        unsigned int lo = (unsigned int)value;
+        unsigned int qhi = hi / base;
+        unsigned int r = hi - qhi * base;
+        unsigned int t = (r << 16) | (lo >> 16);
+        unsigned int q1 = t / base;
+        r = t - q1 * base;
+        t = (r << 16) | (lo & 0xFFFF);
+        unsigned int q0 = t / base;
+        r = t - q0 * base;
+        value = ((unsigned long long)qhi << 32) | (q1 << 16) | q0;
+        tmp[n++] = tab[r];
+    } while (value != 0);
+
+    for (int i = 0; i < n; i++) {
+        buf[i] = tmp[n - 1 - i];
+    }
+    buf[n] = '\0';
+    return n;
+}
@@ -0,0 +1,153 @@
+#include "crash.h"
+#include "dtekv-lib.h"
+#include "csr.h"
+#include "utils.h"
+
+extern char _text_begin[];
+extern char _text_end[];
+extern char _stack_begin[];
+extern char _stack_end[];
+extern void _start(void);
+
+/* Not cleared by the start-up code; see the linker script */
+static struct crash_record record __attribute__((section(".noinit")));
+
+static int reset_on_crash;
+static int in_crash;
+
+#define RECORD_WORDS (sizeof(struct crash_record) / sizeof(unsigned int))
+
+/* ===== Capture ===== */
+
+static unsigned int record_sum(const struct crash_record *r) {
+    const unsigned int *w = (const unsigned int *)r;
+    unsigned int sum = 0;
+    for (unsigned int i = 0; i < RECORD_WORDS; i++)
+        sum += w[i];
+    return sum;
+}
+
+static int record_valid(const struct crash_record *r) {
+    return r->magic == CRASH_MAGIC && r->size == sizeof(*r) && record_sum(r) == 0;
+}
+
+/* Whether addr follows a jal or jalr that wrote ra, i.e. is a return address */
+static int is_return_address(unsigned int addr) {
+    if ((addr & 3) || addr < (unsigned int)_text_begin + 4 || addr >= (unsigned int)_text_end)
+        return 0;
+    unsigned int insn = *(const unsigned int *)(addr - 4);
+    unsigned int opcode = insn & 0x7F;
+    unsigned int rd = (insn >> 7) & 0x1F;
+    return rd == 1 && (opcode == 0x6F || (opcode == 0x67 && ((insn >> 12) & 7) == 0));
+}
+
+static void backtrace_add(struct crash_record *r, unsigned int addr) {
+    if (r->depth < CRASH_MAX_FRAMES)
+        r->backtrace[r->depth++] = addr;
+}
+
+/* ra first, then return addresses found on the stack above the faulting sp */
+static void collect_backtrace(struct crash_record *r) {
+    unsigned int sp = r->regs[2];
+
+    r->depth = 0;
+    if (is_return_address(r->regs[1]))
+        backtrace_add(r, r->regs[1]);
+
+    if ((sp & 3) || sp < (unsigned int)_stack_begin || sp >= (unsigned int)_stack_end)
+        return;
+    const unsigned int *p = (const unsigned int *)sp;
+    const unsigned int *end = (const unsigned int *)_stack_end;
+    if (end - p > CRASH_SCAN_WORDS)
+        end = p + CRASH_SCAN_WORDS;
+
+    for (; p < end && r->depth < CRASH_MAX_FRAMES; p++) {
+        /* The ra slot of the faulting function holds the same value */
+        if (is_return_address(*p) && !(r->depth == 1 && *p == r->backtrace[0]))
+            backtrace_add(r, *p);
+    }
+}
+
+void crash_handler(const struct crash_frame *frame, unsigned int mcause) {
+    /* A fault while reporting one: stop rather than loop */
+    if (in_crash) {
+        while (1)
+            ;
+    }
+    in_crash = 1;
+
+    unsigned int count = record_valid(&record) ? record.count + 1 : 1;
+
+    record.magic = CRASH_MAGIC;
+    record.size = sizeof(record);
+    record.mcause = mcause;
+    record.mtval = csr_read(mtval);
+    record.mepc = csr_read(mepc);
+    record.mstatus = csr_read(mstatus);
+    record.cycles = csr_read(mcycle);
+    record.count = count;
+    record.regs[0] = 0;
+    for (int i = 1; i < 32; i++)
+        record.regs[i] = frame->x[i];
+    for (int i = 0; i < CRASH_MAX_FRAMES; i++)
+        record.backtrace[i] = 0;
+    collect_backtrace(&record);
+    record.checksum = 0;
+    record.checksum = -record_sum(&record);
+
+    uart_set_tx_policy(UART_TX_BLOCK);
+    crash_print(&record);
+    crash_dump(&record);
+
+    if (reset_on_crash)
+        _start();
+    while (1)
+        ; /* Halt on exception */
+}
+
+void crash_set_reset(int enable) {
+    reset_on_crash = enable;
+}
+
+const struct crash_record *crash_last(void) {
+    return record_valid(&record) ? &record : 0;
+}
+
+void crash_clear(void) {
+    record.magic = 0;
+}
+
+/* ===== Output ===== */
+
+static const char *cause_name(unsigned int mcause) {
+    static const char *const names[] = {
+        "instruction address misaligned", "instruction access fault",
+        "illegal instruction", "breakpoint", "load address misaligned",
+        "load access fault", "store address misaligned", "store access fault",
+    };
+    return mcause < sizeof(names) / sizeof(names[0]) ? names[mcause] : "unknown exception";
+}
+
+void crash_print(const struct crash_record *r) {
+    static const char *const abi[32] = {
+        "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2", "s0", "s1", "a0", "a1",
+        "a2", "a3", "a4", "a5", "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+        "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6",
+    };
+
+    printf("\n[CRASH] %s (mcause=%u), crash #%u at cycle %u\n",
+           cause_name(r->mcause), r->mcause, r->count, r->cycles);
+    printf("  mepc=%08x mtval=%08x mstatus=%08x\n", r->mepc, r->mtval, r->mstatus);
+    for (int i = 0; i < 32; i++)
+        printf("  %-4s %08x%s", abi[i], r->regs[i], (i & 3) == 3 ? "\n" : "");
+    printf("  backtrace:");
+    for (unsigned int i = 0; i < r->depth; i++)
+        printf(" %08x", r->backtrace[i]);
+    printf("\n");
+    uart_flush();
+}
+
+void crash_dump(const struct crash_record *r) {
+    uart_write((const char *)r, sizeof(*r));
+    uart_flush();
+}
@@ -0,0 +1,55 @@
+#include "delay.h"
+#include "csr.h"
+#include "utils.h"
+
+/* Cycles per nanosecond in 0.32 fixed point (below 1 for clocks < 1 GHz) */
+#define NS_TO_CYCLES_Q32 \
+    ((unsigned int)(((unsigned long long)CPU_CLOCK_HZ << 32) / 1000000000ULL))
+
+/* Cycles spent in calling and leaving delay_cycles() beyond the spin */
+static unsigned int overhead;
+
+void delay_cycles(unsigned int cycles) {
+    unsigned int start = csr_read(mcycle);
+    if (cycles <= overhead)
+        return;
+    cycles -= overhead;
+    while (csr_read(mcycle) - start < cycles)
+        ;
+}
+
+/*
+ * Time a known delay from the caller's side. Two back-to-back mcycle
+ * reads give the cost of the measurement itself; whatever exceeds the
+ * requested count after that is call, setup and exit overhead. The
+ * minimum over several runs filters out interrupts.
+ */
+void delay_calibrate(void) {
+    const unsigned int probe = 1000;
+    unsigned int best = ~0u;
+
+    overhead = 0;
+    for (int i = 0; i < 8; i++) {
+        unsigned int t0 = csr_read(mcycle);
+        unsigned int t1 = csr_read(mcycle);
+        delay_cycles(probe);
+        unsigned int t2 = csr_read(mcycle);
+
+        unsigned int extra = (t2 - t1) - (t1 - t0) - probe;
+        if ((int)extra >= 0 && extra < best)
+            best = extra;
+    }
+    overhead = (best == ~0u) ? 0 : best;
+}
+
+unsigned int delay_overhead(void) {
+    return overhead;
+}
+
+void delay_ns(unsigned int ns) {
+    delay_cycles((unsigned int)(((unsigned long long)ns * NS_TO_CYCLES_Q32) >> 32));
+}
+
+void delay_us(unsigned int us) {
+    delay_cycles((unsigned int)us_to_cycles(us));
+}
@@ -1,27 +1,28 @@
 #include "devices.h"
-
-/* Memory-mapped I/O addresses */
-#define LED_BASE 0x04000000
-#define SW_BASE 0x04000010
-#define BTN_BASE 0x040000D0
-#define DISP_BASE 0x04000050
-#define GPIO1_BASE 0x040000E0
-#define GPIO2_BASE 0x040000F0
+#include "convert.h"
+#include "atomic.h"
 
 /* Display parameters */
-#define NUM_DISPLAYS 6
-#define DISP_STRIDE 0x10
+#define NUM_DISPLAYS DISPLAY_COUNT
 
-/* 7-segment encoding (common cathode) */
+/*
+ * 7-segment encoding (active low): bit 0-6 = segments a-g, bit 7 = decimal
+ * point; a 0 bit lights the segment
+ */
 static const unsigned char seg_table[16] = {
     0xC0, 0xF9, 0xA4, 0xB0, 0x99,      /* 0-4 */
     0x92, 0x82, 0xF8, 0x80, 0x90,      /* 5-9 */
     0x88, 0x83, 0xC6, 0xA1, 0x86, 0x8E /* A-F */
 };
 
-/* Extended character encoding for display_string */
+/*
+ * Extended character encoding for display_string. Letters are case
+ * insensitive; M, V, W and X have no usable shape and are skipped.
+ */
 static const unsigned char char_table[128] = {
-    [' '] = 0xFF, ['-'] = 0xBF, ['_'] = 0xF7,
+    [' '] = 0xFF, ['-'] = 0xBF, ['_'] = 0xF7, ['='] = 0xB7,
+    ['"'] = 0xDD, ['\''] = 0xFD, ['['] = 0xC6, [']'] = 0xF0,
+    ['?'] = 0xAC,
     ['0'] = 0xC0, ['1'] = 0xF9, ['2'] = 0xA4, ['3'] = 0xB0, ['4'] = 0x99,
     ['5'] = 0x92, ['6'] = 0x82, ['7'] = 0xF8, ['8'] = 0x80, ['9'] = 0x90,
     ['A'] = 0x88, ['a'] = 0x88,
@@ -30,47 +31,64 @@ static const unsigned char char_table[128] = {
     ['D'] = 0xA1, ['d'] = 0xA1,
     ['E'] = 0x86, ['e'] = 0x86,
     ['F'] = 0x8E, ['f'] = 0x8E,
+    ['G'] = 0xC2, ['g'] = 0xC2,
     ['H'] = 0x89, ['h'] = 0x89,
+    ['I'] = 0xCF, ['i'] = 0xCF,
+    ['J'] = 0xE1, ['j'] = 0xE1,
+    ['K'] = 0x8A, ['k'] = 0x8A,
     ['L'] = 0xC7, ['l'] = 0xC7,
+    ['N'] = 0xAB, ['n'] = 0xAB,
     ['O'] = 0xC0, ['o'] = 0xC0,
     ['P'] = 0x8C, ['p'] = 0x8C,
+    ['Q'] = 0x98, ['q'] = 0x98,
+    ['R'] = 0xAF, ['r'] = 0xAF,
+    ['S'] = 0x92, ['s'] = 0x92,
+    ['T'] = 0x87, ['t'] = 0x87,
     ['U'] = 0xC1, ['u'] = 0xC1,
+    ['Y'] = 0x91, ['y'] = 0x91,
+    ['Z'] = 0xA4, ['z'] = 0xA4,
 };
 
-/* LED driver state */
-static volatile unsigned int *led_ptr = (volatile unsigned int *)LED_BASE;
-static unsigned int led_state = 0;
+/*
+ * LED driver state. Read-modify-write updates of led_state and the
+ * register write that follows run with interrupts masked, so an ISR
+ * changing other LEDs cannot be lost in between.
+ */
+static volatile unsigned int led_state = 0;
+
+/* Apply (led_state & ~clear) ^ flip atomically with respect to ISRs */
+static void led_update(unsigned int clear, unsigned int flip) {
+    unsigned int s = irq_save();
+    led_state = (led_state & ~clear) ^ flip;
+    mmio_write32(LED_BASE, led_state);
+    irq_restore(s);
+}
 
 /* ===== LED Functions ===== */
 
 void led_init(void) {
-    led_state = 0;
-    *led_ptr = 0;
+    led_update(0x3FF, 0);
 }
 
 void led_set(unsigned int mask) {
-    led_state = mask & 0x3FF; /* 10 LEDs */
-    *led_ptr = led_state;
+    led_update(0x3FF, mask & 0x3FF); /* 10 LEDs */
 }
 
 void led_on(int led_num) {
     if (led_num >= 0 && led_num < 10) {
-        led_state |= (1 << led_num);
-        *led_ptr = led_state;
+        led_update(1 << led_num, 1 << led_num);
     }
 }
 
 void led_off(int led_num) {
     if (led_num >= 0 && led_num < 10) {
-        led_state &= ~(1 << led_num);
-        *led_ptr = led_state;
+        led_update(1 << led_num, 0);
     }
 }
 
 void led_toggle(int led_num) {
     if (led_num >= 0 && led_num < 10) {
-        led_state ^= (1 << led_num);
-        *led_ptr = led_state;
+        led_update(0, 1 << led_num);
     }
 }
 
@@ -78,42 +96,110 @@ unsigned int led_get(void) { return led_state; }
 
 /* ===== 7-Segment Display Functions ===== */
 
-/* Low-level helper: write raw segment value to display */
-static void display_set_raw(int display_num, unsigned char value) {
+/*
+ * Display framebuffer. Updates only change disp_shadow and mark the digit
+ * in disp_dirty; display_commit() writes just the dirty registers. With
+ * autocommit on (the default) every display_* call commits on return.
+ */
+static unsigned char disp_shadow[NUM_DISPLAYS];
+static unsigned int disp_dirty;
+static int disp_autocommit = 1;
+
+static inline void display_put(int display_num, unsigned char segments) {
+    if (disp_shadow[display_num] != segments) {
+        disp_shadow[display_num] = segments;
+        disp_dirty |= 1 << display_num;
+    }
+}
+
+static inline void display_auto(void) {
+    if (disp_autocommit)
+        display_commit();
+}
+
+void display_commit(void) {
+    unsigned int s = irq_save();
+    unsigned int dirty = disp_dirty;
+    disp_dirty = 0;
+    for (int i = 0; dirty != 0; i++, dirty >>= 1) {
+        if (dirty & 1)
+            mmio_write32(DISP_DATA(i), disp_shadow[i]);
+    }
+    irq_restore(s);
+}
+
+void display_set_autocommit(int enable) {
+    disp_autocommit = enable;
+    display_auto();
+}
+
+void display_set_segments(int display_num, unsigned char segments) {
     if (display_num < 0 || display_num >= NUM_DISPLAYS)
         return;
+    display_put(display_num, segments);
+    display_auto();
+}
+
+unsigned char display_get_segments(int display_num) {
+    if (display_num < 0 || display_num >= NUM_DISPLAYS)
+        return DISPLAY_BLANK;
+    return disp_shadow[display_num];
+}
 
-    volatile unsigned int *addr =
-        (volatile unsigned int *)(DISP_BASE + (display_num * DISP_STRIDE));
-    *addr = value & 0xFF;
+/* Replace all six digits at once; frame[0] is the rightmost display */
+void display_set_frame(const unsigned char *frame) {
+    for (int i = 0; i < NUM_DISPLAYS; i++)
+        display_put(i, frame[i]);
+    display_auto();
+}
+
+void display_set_dp(int display_num, int on) {
+    if (display_num < 0 || display_num >= NUM_DISPLAYS)
+        return;
+    unsigned char segments = disp_shadow[display_num];
+    display_put(display_num, on ? segments & ~DISPLAY_SEG_DP : segments | DISPLAY_SEG_DP);
+    display_auto();
+}
+
+/* Segment pattern for a character, DISPLAY_BLANK if it has none */
+unsigned char display_encode_char(char c) {
+    unsigned char uc = (unsigned char)c;
+    if (uc < 128 && char_table[uc] != 0)
+        return char_table[uc];
+    return DISPLAY_BLANK;
 }
 
 void display_init(void) {
-    display_clear_all();
+    /* Force every register to be written once */
+    for (int i = 0; i < NUM_DISPLAYS; i++)
+        disp_shadow[i] = DISPLAY_BLANK;
+    disp_dirty = (1 << NUM_DISPLAYS) - 1;
+    display_commit();
 }
 
 void display_clear(int display_num) {
-    display_set_raw(display_num, 0xFF); /* All segments off */
+    display_set_segments(display_num, DISPLAY_BLANK); /* All segments off */
 }
 
 void display_clear_all(void) {
     for (int i = 0; i < NUM_DISPLAYS; i++) {
-        display_clear(i);
+        display_put(i, DISPLAY_BLANK);
     }
+    display_auto();
 }
 
 void display_digit(int display_num, unsigned char digit) {
     if (digit < 16) {
-        display_set_raw(display_num, seg_table[digit]);
+        display_set_segments(display_num, seg_table[digit]);
     }
 }
 
 void display_hex(unsigned int number) {
     /* Display number in hexadecimal (max 0xFFFFFF for 6 displays) */
     for (int i = 0; i < NUM_DISPLAYS; i++) {
-        unsigned char digit = (number >> ((NUM_DISPLAYS - 1 - i) * 4)) & 0xF;
-        display_digit(NUM_DISPLAYS - 1 - i, digit);
+        display_put(i, seg_table[(number >> (i * 4)) & 0xF]);
     }
+    display_auto();
 }
 
 void display_decimal(unsigned int number) {
@@ -121,39 +207,95 @@ void display_decimal(unsigned int number) {
     if (number > 999999) {
         number = 999999;
     }
+    display_number(number, 0);
+}
 
-    /* Extract decimal digits */
-    int leading_zero = 1;
-    for (int i = NUM_DISPLAYS - 1; i >= 0; i--) {
-        unsigned char digit = (number / 1) % 10;
-
-        /* Skip leading zeros except for the last digit */
-        if (digit == 0 && leading_zero && i > 0) {
-            display_clear(i);
-        } else {
-            display_digit(i, digit);
-            leading_zero = 0;
+/*
+ * Format a number into the six digits. decimals > 0 lights the decimal
+ * point that many digits from the right and keeps a leading zero before
+ * it. Shows "------" if the result does not fit.
+ */
+static void display_format(int value, int decimals, int flags) {
+    char digits[CONV_DEC32_SIZE];
+    unsigned int magnitude = value;
+    int negative = 0;
+    int len;
+
+    if (flags & DISPLAY_HEX) {
+        len = u32_to_hex(magnitude, digits, 1, 1);
+    } else {
+        if (value < 0) {
+            negative = 1;
+            magnitude = 0u - magnitude;
         }
+        len = u32_to_dec(magnitude, digits);
+    }
+
+    /* Digits to show, including zeros needed in front of the point */
+    int shown = len > decimals ? len : decimals + 1;
+    int width = (flags & DISPLAY_ZERO_PAD) ? NUM_DISPLAYS : shown + negative;
+
+    if (shown + negative > NUM_DISPLAYS) {
+        for (int i = 0; i < NUM_DISPLAYS; i++)
+            display_put(i, char_table['-']);
+        display_auto();
+        return;
+    }
 
-        number /= 10;
+    /* Digit positions counted from the right of the number */
+    int shift = (flags & DISPLAY_LEFT) ? NUM_DISPLAYS - width : 0;
+    for (int i = 0; i < NUM_DISPLAYS; i++) {
+        int pos = i - shift;
+        unsigned char segments = DISPLAY_BLANK;
+        if (pos >= 0 && pos < width) {
+            if (pos < shown) {
+                char c = pos < len ? digits[len - 1 - pos] : '0';
+                segments = char_table[(unsigned char)c];
+            } else if (flags & DISPLAY_ZERO_PAD) {
+                segments = (negative && pos == width - 1) ? char_table['-'] : char_table['0'];
+            } else if (negative) {
+                segments = char_table['-'];
+            }
+            if (decimals > 0 && pos == decimals)
+                segments &= ~DISPLAY_SEG_DP;
+        }
+        display_put(i, segments);
     }
+    display_auto();
+}
+
+void display_number(int value, int flags) {
+    display_format(value, 0, flags);
+}
+
+void display_fixed(int value, int decimals, int flags) {
+    if (decimals < 0 || decimals >= NUM_DISPLAYS)
+        decimals = 0;
+    display_format(value, decimals, flags);
 }
 
 void display_string(const char *str) {
     /* Display up to 6 characters from left to right */
     int display_pos = NUM_DISPLAYS - 1;
+    int dot_ok = 0;     /* Previous position can take a '.' */
 
-    /* Clear all displays first */
-    display_clear_all();
-
-    /* Fill from right to left */
+    /* Build the whole frame; unused positions are blank */
     for (int i = 0; str[i] != '\0' && display_pos >= 0; i++) {
         unsigned char c = str[i];
-        if (c < 128 && char_table[c] != 0) {
-            display_set_raw(display_pos, char_table[c]);
-            display_pos--;
+        if (c == '.' && dot_ok) {
+            /* Light the point of the previous character */
+            display_put(display_pos + 1, disp_shadow[display_pos + 1] & ~DISPLAY_SEG_DP);
+            dot_ok = 0;
+        } else if (c == '.') {
+            display_put(display_pos--, DISPLAY_BLANK & ~DISPLAY_SEG_DP);
+        } else if (c < 128 && char_table[c] != 0) {
+            display_put(display_pos--, char_table[c]);
+            dot_ok = 1;
         }
     }
+    while (display_pos >= 0)
+        display_put(display_pos--, DISPLAY_BLANK);
+    display_auto();
 }
 
 /* ===== Button Functions ===== */
@@ -163,8 +305,7 @@ void button_init(void) {
 }
 
 int button_is_pressed(void) {
-    volatile unsigned int *btn_ptr = (volatile unsigned int *)BTN_BASE;
-    return (*btn_ptr & 0x1) != 0;
+    return (mmio_read32(BTN_DATA) & 0x1) != 0;
 }
 
 /* ===== Switch Functions ===== */
@@ -174,8 +315,7 @@ void switch_init(void) {
 }
 
 unsigned int switch_read(void) {
-    volatile unsigned int *sw_ptr = (volatile unsigned int *)SW_BASE;
-    return *sw_ptr & 0x3FF; /* 10 switches */
+    return mmio_read32(SW_DATA) & 0x3FF; /* 10 switches */
 }
 
 int switch_get(int switch_num) {
@@ -186,92 +326,172 @@ int switch_get(int switch_num) {
 
 /* ===== GPIO Functions ===== */
 
+/*
+ * Shadow copies of the output and direction registers. Writes update the
+ * shadow and store it, so changing a pin never needs an MMIO read first.
+ */
+static unsigned int gpio_out[GPIO_BANK_COUNT];
+static unsigned int gpio_dir[GPIO_BANK_COUNT];
+
 void gpio_init(void) {
-    /* Set all GPIO pins as inputs by default */
-    volatile unsigned int *gpio1_dir =
-        (volatile unsigned int *)(GPIO1_BASE + 0x04);
-    volatile unsigned int *gpio2_dir =
-        (volatile unsigned int *)(GPIO2_BASE + 0x04);
-    *gpio1_dir = 0x00000000; /* All inputs */
-    *gpio2_dir = 0x00000000; /* All inputs */
+    for (int bank = 0; bank < GPIO_BANK_COUNT; bank++) {
+        mmio_write32(GPIO_DIR(bank), 0x00000000); /* All inputs */
+        gpio_dir[bank] = 0;
+        gpio_out[bank] = mmio_read32(GPIO_DATA(bank)) & GPIO_BANK_MASK;
+    }
 }
 
-void gpio_set_direction(int pin, int output) {
-    if (pin < 0 || pin >= GPIO_PIN_COUNT)
+/* ===== Port Access ===== */
+
+void gpio_port_set_direction(int bank, unsigned int mask, unsigned int outputs) {
+    if ((unsigned int)bank >= GPIO_BANK_COUNT)
         return;
+    mask &= GPIO_BANK_MASK;
 
-    volatile unsigned int *gpio_dir;
-    int bit;
+    unsigned int s = irq_save();
+    gpio_dir[bank] = (gpio_dir[bank] & ~mask) | (outputs & mask);
+    mmio_write32(GPIO_DIR(bank), gpio_dir[bank]);
+    irq_restore(s);
+}
 
-    if (pin < 20) {
-        gpio_dir = (volatile unsigned int *)(GPIO1_BASE + 0x04);
-        bit = pin;
-    } else {
-        gpio_dir = (volatile unsigned int *)(GPIO2_BASE + 0x04);
-        bit = pin - 20;
-    }
+void gpio_port_write(int bank, unsigned int mask, unsigned int value) {
+    if ((unsigned int)bank >= GPIO_BANK_COUNT)
+        return;
+    mask &= GPIO_BANK_MASK;
 
-    if (output) {
-        *gpio_dir |= (1 << bit); /* Set as output */
-    } else {
-        *gpio_dir &= ~(1 << bit); /* Set as input */
-    }
+    unsigned int s = irq_save();
+    gpio_out[bank] = (gpio_out[bank] & ~mask) | (value & mask);
+    mmio_write32(GPIO_DATA(bank), gpio_out[bank]);
+    irq_restore(s);
 }
 
-void gpio_write(int pin, int value) {
-    if (pin < 0 || pin >= GPIO_PIN_COUNT)
+unsigned int gpio_port_read(int bank) {
+    if ((unsigned int)bank >= GPIO_BANK_COUNT)
+        return 0;
+    return mmio_read32(GPIO_DATA(bank)) & GPIO_BANK_MASK;
+}
+
+void gpio_port_set(int bank, unsigned int mask) {
+    gpio_port_write(bank, mask, ~0u);
+}
+
+void gpio_port_clear(int bank, unsigned int mask) {
+    gpio_port_write(bank, mask, 0);
+}
+
+void gpio_port_toggle(int bank, unsigned int mask) {
+    if ((unsigned int)bank >= GPIO_BANK_COUNT)
         return;
 
-    volatile unsigned int *gpio_data;
-    int bit;
+    unsigned int s = irq_save();
+    gpio_out[bank] ^= mask & GPIO_BANK_MASK;
+    mmio_write32(GPIO_DATA(bank), gpio_out[bank]);
+    irq_restore(s);
+}
 
-    if (pin < 20) {
-        gpio_data = (volatile unsigned int *)GPIO1_BASE;
-        bit = pin;
-    } else {
-        gpio_data = (volatile unsigned int *)GPIO2_BASE;
-        bit = pin - 20;
-    }
+/* ===== Single Pins ===== */
 
-    if (value) {
-        *gpio_data |= (1 << bit); /* Set high */
-    } else {
-        *gpio_data &= ~(1 << bit); /* Set low */
-    }
+void gpio_set_direction(int pin, int output) {
+    if (pin < 0 || pin >= GPIO_PIN_COUNT)
+        return;
+    unsigned int bit = GPIO_PIN_MASK(pin);
+    gpio_port_set_direction(GPIO_PIN_BANK(pin), bit, output ? bit : 0);
+}
+
+void gpio_write(int pin, int value) {
+    if (pin < 0 || pin >= GPIO_PIN_COUNT)
+        return;
+    gpio_port_write(GPIO_PIN_BANK(pin), GPIO_PIN_MASK(pin), value ? ~0u : 0);
 }
 
 int gpio_read(int pin) {
     if (pin < 0 || pin >= GPIO_PIN_COUNT)
         return 0;
+    return (mmio_read32(GPIO_DATA(GPIO_PIN_BANK(pin))) & GPIO_PIN_MASK(pin)) != 0;
+}
 
-    volatile unsigned int *gpio_data;
-    int bit;
+void gpio_toggle(int pin) {
+    if (pin < 0 || pin >= GPIO_PIN_COUNT)
+        return;
+    gpio_port_toggle(GPIO_PIN_BANK(pin), GPIO_PIN_MASK(pin));
+}
 
-    if (pin < 20) {
-        gpio_data = (volatile unsigned int *)GPIO1_BASE;
-        bit = pin;
-    } else {
-        gpio_data = (volatile unsigned int *)GPIO2_BASE;
-        bit = pin - 20;
+/* ===== Pin Groups ===== */
+
+/*
+ * Split the pin list into runs of consecutive logical bits that sit on
+ * consecutive pins of one bank. An 8-bit bus wired to pins 4-11 is a
+ * single run and is written with one shift and mask per access.
+ */
+int gpio_group_init(struct gpio_group *g, const unsigned char *pins, int width) {
+    if (width < 1 || width > GPIO_GROUP_MAX)
+        return -1;
+
+    g->width = width;
+    g->run_count = 0;
+    for (int bank = 0; bank < GPIO_BANK_COUNT; bank++)
+        g->bank_mask[bank] = 0;
+
+    struct gpio_run *run = 0;
+    for (int i = 0; i < width; i++) {
+        if (pins[i] >= GPIO_PIN_COUNT)
+            return -1;
+        int bank = pins[i] / GPIO_BANK_PINS;
+        int bit = pins[i] - bank * GPIO_BANK_PINS;
+        if (g->bank_mask[bank] & (1u << bit))
+            return -1; /* Pin listed twice */
+        g->bank_mask[bank] |= 1u << bit;
+
+        if (run && run->bank == bank && run->pin_bit + run->width == bit) {
+            run->width++;
+        } else {
+            run = &g->runs[g->run_count++];
+            run->bank = bank;
+            run->first_bit = i;
+            run->pin_bit = bit;
+            run->width = 1;
+        }
     }
+    return 0;
+}
 
-    return (*gpio_data >> bit) & 0x1;
+void gpio_group_set_direction(const struct gpio_group *g, int output) {
+    for (int bank = 0; bank < GPIO_BANK_COUNT; bank++) {
+        if (g->bank_mask[bank])
+            gpio_port_set_direction(bank, g->bank_mask[bank], output ? ~0u : 0);
+    }
 }
 
-void gpio_toggle(int pin) {
-    if (pin < 0 || pin >= GPIO_PIN_COUNT)
-        return;
+void gpio_group_write(const struct gpio_group *g, unsigned int value) {
+    unsigned int bits[GPIO_BANK_COUNT] = {0};
 
-    volatile unsigned int *gpio_data;
-    int bit;
+    for (int i = 0; i < g->run_count; i++) {
+        const struct gpio_run *r = &g->runs[i];
+        bits[r->bank] |= ((value >> r->first_bit) & ((1u << r->width) - 1)) << r->pin_bit;
+    }
 
-    if (pin < 20) {
-        gpio_data = (volatile unsigned int *)GPIO1_BASE;
-        bit = pin;
-    } else {
-        gpio_data = (volatile unsigned int *)GPIO2_BASE;
-        bit = pin - 20;
+    /* Both banks are stored back to back with interrupts held off */
+    unsigned int s = irq_save();
+    for (int bank = 0; bank < GPIO_BANK_COUNT; bank++) {
+        unsigned int mask = g->bank_mask[bank];
+        if (mask) {
+            gpio_out[bank] = (gpio_out[bank] & ~mask) | bits[bank];
+            mmio_write32(GPIO_DATA(bank), gpio_out[bank]);
+        }
     }
+    irq_restore(s);
+}
+
+unsigned int gpio_group_read(const struct gpio_group *g) {
+    unsigned int data[GPIO_BANK_COUNT];
+    unsigned int value = 0;
 
-    *gpio_data ^= (1 << bit); /* Toggle bit */
+    for (int bank = 0; bank < GPIO_BANK_COUNT; bank++)
+        data[bank] = g->bank_mask[bank] ? mmio_read32(GPIO_DATA(bank)) : 0;
+
+    for (int i = 0; i < g->run_count; i++) {
+        const struct gpio_run *r = &g->runs[i];
+        value |= ((data[r->bank] >> r->pin_bit) & ((1u << r->width) - 1)) << r->first_bit;
+    }
+    return value;
 }
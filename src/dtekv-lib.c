@@ -1,5 +1,14 @@
 #include "dtekv-lib.h"
 #include "devices.h"
+#include "csr.h"
+#include "atomic.h"
+#include "convert.h"
+#include "delay.h"
+#include "timer.h"
+#include "sched.h"
+#include "irq.h"
+#include "evq.h"
+#include "crash.h"
 
 /* ===== ISR Function Pointers ===== */
 
@@ -7,68 +16,323 @@ void (*timer_isr)(void) = 0;
 void (*switch_isr)(unsigned int) = 0;
 void (*button_isr)(unsigned int) = 0;
 
-/* ===== JTAG UART I/O Functions ===== */
+/* ===== Buffered JTAG UART Transmit ===== */
+
+/*
+ * printc()/print() only append to a ring buffer. The buffer is drained in
+ * bulk, as many bytes as WSPACE reports, either from the UART write
+ * interrupt (uart_set_tx_irq(1)) or opportunistically after each call.
+ * Head and tail are free-running; their difference is the fill level.
+ */
+
+#if (UART_TX_BUF_SIZE & (UART_TX_BUF_SIZE - 1)) != 0
+#error "UART_TX_BUF_SIZE must be a power of two"
+#endif
+#define UART_TX_MASK (UART_TX_BUF_SIZE - 1)
+
+static char uart_tx_buf[UART_TX_BUF_SIZE];
+static volatile unsigned int uart_tx_head;  /* Next free slot */
+static volatile unsigned int uart_tx_tail;  /* Next byte to send */
+static int uart_tx_policy = UART_TX_BLOCK;
+static int uart_tx_irq;                     /* Drained by interrupt */
+static unsigned int uart_ctrl;              /* Shadow of RE/WE enable bits */
+static struct uart_stats uart_stats;
+
+/* Move as many queued bytes as the hardware FIFO can take */
+static unsigned int uart_tx_drain(void) {
+    unsigned int s = irq_save();
+    unsigned int tail = uart_tx_tail;
+    unsigned int pending = uart_tx_head - tail;
+
+    if (pending != 0) {
+        unsigned int space = (mmio_read32(JTAG_UART_CTRL) & JTAG_UART_WSPACE_MASK) >> 16;
+        if (space > pending)
+            space = pending;
+        pending -= space;
+        while (space--) {
+            mmio_write32(JTAG_UART_DATA, uart_tx_buf[tail & UART_TX_MASK]);
+            tail++;
+        }
+        uart_tx_tail = tail;
+    }
+
+    irq_restore(s);
+    return pending;
+}
+
+/* Append one byte, applying the full-buffer policy. Caller holds the lock. */
+static void uart_tx_put(char c, unsigned int *s) {
+    while (uart_tx_head - uart_tx_tail >= UART_TX_BUF_SIZE) {
+        if (uart_tx_policy == UART_TX_DROP) {
+            uart_stats.tx_dropped++;
+            return;
+        }
+        if (uart_tx_policy == UART_TX_OVERWRITE) {
+            uart_tx_tail++;
+            uart_stats.tx_overwritten++;
+            break;
+        }
+        /* UART_TX_BLOCK: drain directly, works with interrupts masked */
+        irq_restore(*s);
+        uart_tx_drain();
+        *s = irq_save();
+    }
+
+    uart_tx_buf[uart_tx_head & UART_TX_MASK] = c;
+    uart_tx_head++;
+
+    unsigned int fill = uart_tx_head - uart_tx_tail;
+    if (fill > uart_stats.tx_high_water)
+        uart_stats.tx_high_water = fill;
+}
+
+/* Start transmission of newly queued data */
+static void uart_tx_kick(void) {
+    if (uart_tx_irq) {
+        if (!(uart_ctrl & JTAG_UART_CTRL_WE)) {
+            unsigned int s = irq_save();
+            uart_ctrl |= JTAG_UART_CTRL_WE;
+            mmio_write32(JTAG_UART_CTRL, uart_ctrl);
+            irq_restore(s);
+        }
+    } else {
+        uart_tx_drain();
+    }
+}
 
 /* Print a single character to JTAG UART */
 void printc(char c) {
-    while (((*JTAG_UART_CTRL) & JTAG_UART_WSPACE_MASK) == 0)
-        ;
-    *JTAG_UART_DATA = c;
+    unsigned int s = irq_save();
+    uart_tx_put(c, &s);
+    irq_restore(s);
+    uart_tx_kick();
 }
 
 /* Print a null-terminated string */
 void print(char *s) {
     if (s == 0)
         return;
+    unsigned int st = irq_save();
     while (*s != '\0') {
-        printc(*s);
+        uart_tx_put(*s, &st);
         s++;
     }
+    irq_restore(st);
+    uart_tx_kick();
+}
+
+/* Queue a block of bytes for transmission */
+void uart_write(const char *buf, int n) {
+    if (buf == 0 || n <= 0)
+        return;
+    unsigned int s = irq_save();
+    for (int i = 0; i < n; i++) {
+        uart_tx_put(buf[i], &s);
+    }
+    irq_restore(s);
+    uart_tx_kick();
+}
+
+/* Wait until every queued byte has been handed to the hardware FIFO */
+void uart_flush(void) {
+    while (uart_tx_drain() != 0)
+        ;
+}
+
+unsigned int uart_tx_pending(void) {
+    return uart_tx_head - uart_tx_tail;
+}
+
+void uart_set_tx_policy(int policy) {
+    uart_tx_policy = policy;
+}
+
+/* Switch between interrupt-driven and opportunistic draining */
+void uart_set_tx_irq(int enable) {
+    unsigned int s = irq_save();
+    uart_tx_irq = enable;
+    if (enable) {
+        irq_enable(IRQ_JTAG_UART);
+    } else {
+        uart_ctrl &= ~JTAG_UART_CTRL_WE;
+        mmio_write32(JTAG_UART_CTRL, uart_ctrl);
+    }
+    irq_restore(s);
+    uart_tx_kick();
+}
+
+void uart_get_stats(struct uart_stats *stats) {
+    unsigned int s = irq_save();
+    *stats = uart_stats;
+    irq_restore(s);
+}
+
+/* ===== Buffered JTAG UART Receive ===== */
+
+/*
+ * Received bytes are moved from the hardware FIFO into a ring buffer,
+ * either by the UART read interrupt (uart_set_rx_irq(1)) or on demand by
+ * the readers below. Completed lines are counted as they arrive so
+ * uart_readline() can tell in O(1) whether a whole line is waiting.
+ */
+
+#if (UART_RX_BUF_SIZE & (UART_RX_BUF_SIZE - 1)) != 0
+#error "UART_RX_BUF_SIZE must be a power of two"
+#endif
+#define UART_RX_MASK (UART_RX_BUF_SIZE - 1)
+
+static char uart_rx_buf[UART_RX_BUF_SIZE];
+static volatile unsigned int uart_rx_head;  /* Next free slot */
+static volatile unsigned int uart_rx_tail;  /* Next byte to read */
+static volatile unsigned int uart_rx_lines; /* Complete lines in the buffer */
+static int uart_rx_irq;                     /* Filled by interrupt */
+
+/* Pull everything the hardware FIFO holds into the ring buffer */
+static void uart_rx_fill(void) {
+    unsigned int s = irq_save();
+    unsigned int data;
+
+    while ((data = mmio_read32(JTAG_UART_DATA)) & JTAG_UART_RVALID_MASK) {
+        char c = (char)(data & JTAG_UART_DATA_MASK);
+        unsigned int fill = uart_rx_head - uart_rx_tail;
+
+        if (fill >= UART_RX_BUF_SIZE) {
+            uart_stats.rx_overflow++;
+            continue;
+        }
+        uart_rx_buf[uart_rx_head & UART_RX_MASK] = c;
+        uart_rx_head++;
+        if (c == '\n')
+            uart_rx_lines++;
+        if (fill + 1 > uart_stats.rx_high_water)
+            uart_stats.rx_high_water = fill + 1;
+    }
+
+    irq_restore(s);
+}
+
+/* Poll the hardware unless the interrupt keeps the buffer up to date */
+static inline void uart_rx_poll(void) {
+    if (!uart_rx_irq)
+        uart_rx_fill();
+}
+
+/* Remove one byte from the buffer. Caller holds the lock and checked fill. */
+static inline char uart_rx_pop(void) {
+    char c = uart_rx_buf[uart_rx_tail & UART_RX_MASK];
+    uart_rx_tail++;
+    if (c == '\n')
+        uart_rx_lines--;
+    return c;
 }
 
 /* Read a single character from JTAG UART (non-blocking) */
 char readc(void) {
-    unsigned int data = *JTAG_UART_DATA;
-    if (data & JTAG_UART_RVALID_MASK) {
-        return (char)(data & JTAG_UART_DATA_MASK);
-    }
-    return 0; /* No data available */
+    char c = 0;
+    uart_rx_poll();
+    unsigned int s = irq_save();
+    if (uart_rx_head != uart_rx_tail)
+        c = uart_rx_pop();
+    irq_restore(s);
+    return c; /* 0 if no data available */
 }
 
-/* Check if data is available to read */
+/* Number of received bytes waiting to be read (does not consume input) */
 int read_available(void) {
-    return (*JTAG_UART_DATA & JTAG_UART_RVALID_MASK) != 0;
+    uart_rx_poll();
+    return uart_rx_head - uart_rx_tail;
+}
+
+/* Copy up to n received bytes into buf, returns the number copied */
+int uart_read(char *buf, int n) {
+    int count = 0;
+    uart_rx_poll();
+    unsigned int s = irq_save();
+    while (count < n && uart_rx_head != uart_rx_tail) {
+        buf[count++] = uart_rx_pop();
+    }
+    irq_restore(s);
+    return count;
+}
+
+/*
+ * Copy the next complete line into buf (without the line terminator) and
+ * return its length, or -1 if no complete line has arrived yet. Lines that
+ * do not fit in buf are truncated. If the ring buffer fills up without a
+ * newline its contents are returned as a truncated line so input can
+ * never stall.
+ */
+int uart_readline(char *buf, int size) {
+    int len = 0;
+    if (buf == 0 || size <= 0)
+        return -1;
+
+    uart_rx_poll();
+    unsigned int s = irq_save();
+
+    unsigned int fill = uart_rx_head - uart_rx_tail;
+    if (uart_rx_lines == 0 && fill < UART_RX_BUF_SIZE) {
+        irq_restore(s);
+        return -1;
+    }
+
+    /* A full buffer without a newline is delivered as a truncated line */
+    int truncated = (uart_rx_lines == 0);
+    while (uart_rx_head != uart_rx_tail) {
+        char c = uart_rx_pop();
+        if (c == '\n')
+            break;
+        if (c == '\r')
+            continue;
+        if (len < size - 1)
+            buf[len++] = c;
+        else
+            truncated = 1;
+    }
+    if (truncated)
+        uart_stats.rx_line_truncated++;
+
+    irq_restore(s);
+    buf[len] = '\0';
+    return len;
+}
+
+/* Fill the receive buffer from the UART read interrupt */
+void uart_set_rx_irq(int enable) {
+    unsigned int s = irq_save();
+    uart_rx_irq = enable;
+    if (enable) {
+        uart_ctrl |= JTAG_UART_CTRL_RE;
+        irq_enable(IRQ_JTAG_UART);
+    } else {
+        uart_ctrl &= ~JTAG_UART_CTRL_RE;
+    }
+    mmio_write32(JTAG_UART_CTRL, uart_ctrl);
+    irq_restore(s);
+}
+
+/* JTAG UART interrupt: empty the receive FIFO, refill the transmit FIFO */
+void uart_isr(void) {
+    if (uart_ctrl & JTAG_UART_CTRL_RE)
+        uart_rx_fill();
+    if (uart_tx_drain() == 0 && (uart_ctrl & JTAG_UART_CTRL_WE)) {
+        uart_ctrl &= ~JTAG_UART_CTRL_WE;
+        mmio_write32(JTAG_UART_CTRL, uart_ctrl);
+    }
 }
 
 /* ===== Number Formatting Functions ===== */
 
 /* Print a signed decimal integer */
 void print_dec(int x) {
-    if (x < 0) {
-        printc('-');
-        x = -x;
-    }
-    print_udec((unsigned int)x);
+    char buf[CONV_DEC32_SIZE + 1];
+    uart_write(buf, i32_to_dec(x, buf));
 }
 
 /* Print an unsigned decimal integer */
 void print_udec(unsigned int x) {
-    unsigned int divisor = 1000000000;
-    char started = 0;
-
-    do {
-        int digit = x / divisor;
-        if (digit != 0 || started) {
-            printc('0' + digit);
-            started = 1;
-        }
-        x -= digit * divisor;
-        divisor /= 10;
-    } while (divisor != 0);
-
-    if (!started) {
-        printc('0');
-    }
+    char buf[CONV_DEC32_SIZE];
+    uart_write(buf, u32_to_dec(x, buf));
 }
 
 /* Print a 32-bit hexadecimal value (8 digits) */
@@ -78,133 +342,120 @@ void print_hex32(unsigned int x) {
 
 /* Print a hexadecimal value with specified number of digits */
 void print_hex(unsigned int x, int digits) {
-    printc('0');
-    printc('x');
-    for (int i = digits - 1; i >= 0; i--) {
-        char nibble = (char)((x >> (i * 4)) & 0xF);
-        if (nibble < 10) {
-            printc('0' + nibble);
-        } else {
-            printc('A' + (nibble - 10));
-        }
-    }
+    char buf[2 + 8 + 1];
+    buf[0] = '0';
+    buf[1] = 'x';
+    if (digits > 0 && digits < 8)
+        x &= (1u << (4 * digits)) - 1;
+    uart_write(buf, 2 + u32_to_hex(x, buf + 2, digits, 1));
 }
 
 /* Print a binary value with specified number of bits */
 void print_bin(unsigned int x, int bits) {
-    printc('0');
-    printc('b');
-    for (int i = bits - 1; i >= 0; i--) {
-        printc((x & (1 << i)) ? '1' : '0');
-    }
+    char buf[2 + 32 + 1];
+    buf[0] = '0';
+    buf[1] = 'b';
+    if (bits > 0 && bits < 32)
+        x &= (1u << bits) - 1;
+    uart_write(buf, 2 + u32_to_bin(x, buf + 2, bits));
 }
 
 /* ===== Exception Handler ===== */
 
+/*
+ * ecall passes its arguments in arg0-arg5 and the syscall number. Other
+ * exceptions pass mepc and the saved registers (struct crash_frame) in
+ * arg0 and arg1, and are reported by the crash handler (crash.h).
+ */
 void handle_exception(unsigned arg0, unsigned arg1, unsigned arg2,
                       unsigned arg3, unsigned arg4, unsigned arg5,
                       unsigned mcause, unsigned syscall_num) {
-    switch (mcause) {
-    case 0:
-        print("\n[EXCEPTION] Instruction address misalignment.\n");
-        break;
-    case 2:
-        print("\n[EXCEPTION] Illegal instruction.\n");
-        break;
-    case 11: /* Environment call (ecall) */
+    if (mcause == 11) { /* Environment call (ecall) */
         if (syscall_num == 4) {
-            print((char *)arg0);
+            print((char *)(unsigned long)arg0);
         } else if (syscall_num == 11) {
             printc(arg0);
         }
         return;
-    default:
-        print("\n[EXCEPTION] Unknown error (mcause=");
-        print_udec(mcause);
-        print(").\n");
-        break;
     }
 
-    print("Exception Address: ");
-    print_hex32(arg0);
-    printc('\n');
-    while (1)
-        ; /* Halt on exception */
+    crash_handler((const struct crash_frame *)(unsigned long)arg1, mcause);
 }
 
-/* ===== Interrupt Handler ===== */
+/* ===== Interrupt Handlers ===== */
 
-void handle_interrupt(unsigned cause) {
-    switch (cause) {
-    case IRQ_TIMER:
-        /* Timer interrupt - fires when timer reaches 0 */
-        /* Clear timeout flag by writing to status register */
-        *TIMER_STATUS = 0;
-
-        /* Call user-defined timer ISR if provided */
-        if (timer_isr) {
-            timer_isr();
-        } else {
-            print("[IRQ] Timer interrupt (no handler)\n");
-        }
-        break;
-
-    case IRQ_SWITCHES:
-        /* Switch interrupt - fires when switch state changes */
-        /* Read switch state and edge capture */
-        unsigned int switch_state = *SW_DATA;
-        unsigned int edge_bits = *SW_EDGE_CAPTURE;
-
-        /* Clear edge capture by writing 1s to the bits that fired */
-        *SW_EDGE_CAPTURE = edge_bits;
-
-        /* Call user-defined switch ISR if provided */
-        if (switch_isr) {
-            switch_isr(switch_state);
-        } else {
-            print("[IRQ] Switch interrupt, state: ");
-            print_hex(switch_state, 4);
-            print(" edges: ");
-            print_hex(edge_bits, 4);
-            print("\n");
-        }
-        break;
-
-    case IRQ_BUTTON:
-        /* Button interrupt - fires when button is pressed */
-        /* Read button state and edge capture */
-        unsigned int button_state = *BTN_DATA;
-        unsigned int btn_edge = *BTN_EDGE_CAPTURE;
-
-        /* Clear edge capture by writing 1s to the bits that fired */
-        *BTN_EDGE_CAPTURE = btn_edge;
-
-        /* Call user-defined button ISR if provided */
-        if (button_isr) {
-            button_isr(button_state);
-        } else {
-            print("[IRQ] Button interrupt, state: ");
-            print_hex(button_state, 2);
-            print("\n");
-        }
-        break;
+/* Timer interrupt - fires when timer reaches 0 */
+void handle_timer_irq(unsigned int cause, void *ctx) {
+    /* Clear timeout flag by writing to status register */
+    mmio_write16(TIMER_STATUS, 0);
+
+    /* Run expired software timers (see timer.h) */
+    int handled = timer_service_isr();
+
+    /* Call user-defined timer ISR if provided */
+    if (timer_isr) {
+        timer_isr();
+    } else if (!handled) {
+        evq_post(&irq_events, cause, 0, 0);
+    }
+}
+
+/* Switch interrupt - fires when switch state changes */
+void handle_switch_irq(unsigned int cause, void *ctx) {
+    /* Read switch state and edge capture */
+    unsigned int switch_state = mmio_read32(SW_DATA);
+    unsigned int edge_bits = mmio_read32(SW_EDGE_CAPTURE);
+
+    /* Clear edge capture by writing 1s to the bits that fired */
+    mmio_write32(SW_EDGE_CAPTURE, edge_bits);
 
-    default:
-        /* Unknown interrupt */
-        print("[IRQ] Unknown interrupt (cause=");
-        print_udec(cause);
-        print(")\n");
-        break;
+    /* Call user-defined switch ISR if provided */
+    if (switch_isr) {
+        switch_isr(switch_state);
+    } else {
+        /* Defer to main code; drain with evq_drain(&irq_events, ...) */
+        evq_post(&irq_events, cause, switch_state, edge_bits);
     }
 }
 
+/* Button interrupt - fires when button is pressed */
+void handle_button_irq(unsigned int cause, void *ctx) {
+    /* Read button state and edge capture */
+    unsigned int button_state = mmio_read32(BTN_DATA);
+    unsigned int btn_edge = mmio_read32(BTN_EDGE_CAPTURE);
+
+    /* Clear edge capture by writing 1s to the bits that fired */
+    mmio_write32(BTN_EDGE_CAPTURE, btn_edge);
+
+    /* Call user-defined button ISR if provided */
+    if (button_isr) {
+        button_isr(button_state);
+    } else {
+        /* Defer to main code; drain with evq_drain(&irq_events, ...) */
+        evq_post(&irq_events, cause, button_state, btn_edge);
+    }
+}
+
+/* JTAG UART interrupt - data received or FIFO has room again */
+void handle_uart_irq(unsigned int cause, void *ctx) {
+    uart_isr();
+}
+
+/*
+ * Dispatch by cause through the table in irq.c. The vectored trap table
+ * in boot.S calls irq_dispatch() directly; this entry point is used by
+ * the TRAP_FULL_SAVE routine and when mtvec runs in direct mode.
+ */
+void handle_interrupt(unsigned cause) {
+    irq_dispatch(cause);
+
+    /* Switch tasks if the scheduler's time slice ran out (see sched.h) */
+    sched_irq_exit();
+}
+
 /* ===== Utility Functions ===== */
 
-/* Simple delay loop */
+/* Busy-wait for a number of clock cycles (see delay.h) */
 void delay(unsigned int cycles) {
-    for (unsigned int i = 0; i < cycles; i++) {
-        /* Volatile to prevent optimization */
-        volatile int dummy = i;
-        (void)dummy;
-    }
+    delay_cycles(cycles);
 }
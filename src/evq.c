@@ -0,0 +1,131 @@
+#include "evq.h"
+#include "sched.h"
+#include "devices.h"
+#include "csr.h"
+#include "atomic.h"
+#include "utils.h"
+
+#define EVQ_MASK (EVQ_SIZE - 1)
+
+struct evq irq_events;
+
+void evq_init(struct evq *q, struct event *notify) {
+    q->head = 0;
+    q->tail = 0;
+    q->notify = notify;
+    q->posted = 0;
+    q->dropped = 0;
+    q->overflows = 0;
+    q->max_depth = 0;
+    q->full = 0;
+}
+
+/* ===== Producer ===== */
+
+int evq_post(struct evq *q, unsigned int source, unsigned int state,
+             unsigned int edges) {
+    unsigned int head = q->head;
+    unsigned int depth = head - q->tail;
+
+    if (depth >= EVQ_SIZE) {
+        q->dropped++;
+        if (!q->full) {
+            q->full = 1;
+            q->overflows++;
+        }
+        return -1;
+    }
+
+    struct evq_event *ev = &q->slots[head & EVQ_MASK];
+    ev->time = csr_read(mcycle);
+    ev->source = source;
+    ev->state = state;
+    ev->edges = edges;
+
+    /* Publish the slot only after it is fully written */
+    compiler_barrier();
+    q->head = head + 1;
+
+    q->full = 0;
+    q->posted++;
+    if (depth + 1 > q->max_depth)
+        q->max_depth = depth + 1;
+    if (q->notify)
+        event_signal(q->notify);
+    return 0;
+}
+
+/* ===== Consumer ===== */
+
+int evq_pop(struct evq *q, struct evq_event *ev) {
+    unsigned int tail = q->tail;
+    if (tail == q->head)
+        return 0;
+
+    compiler_barrier();
+    *ev = q->slots[tail & EVQ_MASK];
+
+    /* Hand the slot back only after it has been copied */
+    compiler_barrier();
+    q->tail = tail + 1;
+    return 1;
+}
+
+int evq_drain(struct evq *q, evq_handler_t handler, void *ctx, unsigned int max) {
+    unsigned int tail = q->tail;
+    unsigned int head = q->head;    /* Batch: events posted meanwhile wait */
+    int count = 0;
+
+    compiler_barrier();
+    while (tail != head) {
+        struct evq_event ev = q->slots[tail & EVQ_MASK];
+        compiler_barrier();
+        q->tail = ++tail;           /* Free the slot before the slow part */
+        handler(&ev, ctx);
+        count++;
+        if (max != 0 && (unsigned int)count >= max)
+            break;
+    }
+    return count;
+}
+
+unsigned int evq_depth(const struct evq *q) {
+    return q->head - q->tail;
+}
+
+/* ===== Diagnostics ===== */
+
+void evq_get_stats(const struct evq *q, struct evq_stats *stats) {
+    stats->posted = q->posted;
+    stats->dropped = q->dropped;
+    stats->overflows = q->overflows;
+    stats->max_depth = q->max_depth;
+    stats->depth = q->head - q->tail;
+}
+
+/* Print an event the way the default handlers used to from the ISR */
+void evq_print_event(const struct evq_event *ev, void *ctx) {
+    switch (ev->source) {
+    case IRQ_TIMER:
+        printf("[IRQ] Timer interrupt (no handler) @%u\n", ev->time);
+        break;
+    case IRQ_SWITCHES:
+        printf("[IRQ] Switch interrupt, state: 0x%04x edges: 0x%04x @%u\n",
+               ev->state, ev->edges, ev->time);
+        break;
+    case IRQ_BUTTON:
+        printf("[IRQ] Button interrupt, state: 0x%02x @%u\n", ev->state, ev->time);
+        break;
+    default:
+        printf("[IRQ] Event from cause %u, state: 0x%x edges: 0x%x @%u\n",
+               ev->source, ev->state, ev->edges, ev->time);
+        break;
+    }
+}
+
+void evq_report(const struct evq *q, const char *name) {
+    struct evq_stats st;
+    evq_get_stats(q, &st);
+    printf("%s: %u posted, %u dropped in %u overflows, depth %u (max %u of %u)\n",
+           name, st.posted, st.dropped, st.overflows, st.depth, st.max_depth, EVQ_SIZE);
+}
@@ -0,0 +1,237 @@
+#include "i2c.h"
+#include "devices.h"
+#include "delay.h"
+#include "csr.h"
+#include "utils.h"
+
+/* ===== Line Control ===== */
+
+/* Pull a line low by enabling its driver (the latch holds 0) */
+static inline void scl_low(struct i2c_bus *bus) {
+    gpio_port_set_direction(bus->scl_bank, bus->scl_mask, ~0u);
+}
+
+static inline void sda_low(struct i2c_bus *bus) {
+    gpio_port_set_direction(bus->sda_bank, bus->sda_mask, ~0u);
+}
+
+static inline void sda_release(struct i2c_bus *bus) {
+    gpio_port_set_direction(bus->sda_bank, bus->sda_mask, 0);
+}
+
+static inline int sda_read(struct i2c_bus *bus) {
+    return (mmio_read32(GPIO_DATA(bus->sda_bank)) & bus->sda_mask) != 0;
+}
+
+static inline int scl_read(struct i2c_bus *bus) {
+    return (mmio_read32(GPIO_DATA(bus->scl_bank)) & bus->scl_mask) != 0;
+}
+
+static inline void pace(struct i2c_bus *bus) {
+    delay_pace(&bus->deadline, bus->half_period);
+}
+
+/* Release SCL and wait for it to go high; a slave may be stretching it */
+static int scl_release(struct i2c_bus *bus) {
+    gpio_port_set_direction(bus->scl_bank, bus->scl_mask, 0);
+    if (scl_read(bus))
+        return I2C_OK;
+
+    unsigned int start = csr_read(mcycle);
+    while (!scl_read(bus)) {
+        if (csr_read(mcycle) - start > bus->stretch_limit)
+            return I2C_ERR_TIMEOUT;
+    }
+    /* The high phase starts when the slave lets go */
+    bus->deadline = csr_read(mcycle);
+    return I2C_OK;
+}
+
+/* ===== Setup ===== */
+
+void i2c_set_rate(struct i2c_bus *bus, unsigned int hz) {
+    bus->half_period = hz ? (CPU_CLOCK_HZ + 2 * hz - 1) / (2 * hz) : 0;
+}
+
+void i2c_set_stretch_timeout(struct i2c_bus *bus, unsigned int us) {
+    bus->stretch_limit = (unsigned int)us_to_cycles(us);
+}
+
+int i2c_init(struct i2c_bus *bus, int scl, int sda, unsigned int hz) {
+    if (scl < 0 || scl >= GPIO_PIN_COUNT || sda < 0 || sda >= GPIO_PIN_COUNT || scl == sda)
+        return -1;
+
+    bus->scl_bank = GPIO_PIN_BANK(scl);
+    bus->scl_mask = GPIO_PIN_MASK(scl);
+    bus->sda_bank = GPIO_PIN_BANK(sda);
+    bus->sda_mask = GPIO_PIN_MASK(sda);
+    bus->active = 0;
+    i2c_set_rate(bus, hz);
+    i2c_set_stretch_timeout(bus, I2C_STRETCH_US);
+
+    /* Both lines released, latches low for open-drain driving */
+    gpio_port_set_direction(bus->scl_bank, bus->scl_mask, 0);
+    gpio_port_set_direction(bus->sda_bank, bus->sda_mask, 0);
+    gpio_port_clear(bus->scl_bank, bus->scl_mask);
+    gpio_port_clear(bus->sda_bank, bus->sda_mask);
+
+    /*
+     * A slave reset mid-read may still hold SDA low. Clock until it lets
+     * go (at most one byte plus ACK), then leave the bus with a stop.
+     */
+    bus->deadline = csr_read(mcycle);
+    for (int i = 0; i < 9 && !sda_read(bus); i++) {
+        scl_low(bus);
+        pace(bus);
+        if (scl_release(bus) != I2C_OK)
+            return I2C_ERR_BUS;
+        pace(bus);
+    }
+    if (!sda_read(bus))
+        return I2C_ERR_BUS;
+    bus->active = 1;
+    return i2c_stop(bus) == I2C_OK ? I2C_OK : I2C_ERR_BUS;
+}
+
+/* ===== Bus Primitives ===== */
+
+int i2c_start(struct i2c_bus *bus) {
+    if (!bus->active) {
+        bus->deadline = csr_read(mcycle);
+        if (!scl_read(bus) || !sda_read(bus))
+            return I2C_ERR_BUS;
+    } else {
+        /* Repeated start: raise SDA, then SCL, with SCL coming from low */
+        sda_release(bus);
+        pace(bus);
+        if (scl_release(bus) != I2C_OK)
+            return I2C_ERR_TIMEOUT;
+        pace(bus);
+    }
+
+    /* SDA falls while SCL is high */
+    sda_low(bus);
+    pace(bus);
+    scl_low(bus);
+    bus->active = 1;
+    return I2C_OK;
+}
+
+int i2c_stop(struct i2c_bus *bus) {
+    int err = I2C_OK;
+
+    /* SDA rises while SCL is high */
+    sda_low(bus);
+    pace(bus);
+    if (scl_release(bus) != I2C_OK)
+        err = I2C_ERR_TIMEOUT;
+    pace(bus);
+    sda_release(bus);
+    pace(bus);
+    bus->active = 0;
+
+    if (err == I2C_OK && !sda_read(bus))
+        err = I2C_ERR_BUS;
+    return err;
+}
+
+/* One clock with SDA driven (bit = 1 releases it); returns SDA while SCL was high */
+static int clock_bit(struct i2c_bus *bus, int bit) {
+    if (bit)
+        sda_release(bus);
+    else
+        sda_low(bus);
+    pace(bus);
+    if (scl_release(bus) != I2C_OK)
+        return I2C_ERR_TIMEOUT;
+    pace(bus);
+    int level = sda_read(bus);
+    scl_low(bus);
+    return level;
+}
+
+int i2c_write_byte(struct i2c_bus *bus, unsigned int byte) {
+    for (int i = 7; i >= 0; i--) {
+        int bit = (byte >> i) & 1;
+        int level = clock_bit(bus, bit);
+        if (level < 0)
+            return level;
+        if (bit && !level)
+            return I2C_ERR_BUS;     /* Someone else is driving SDA */
+    }
+
+    /* ACK: the slave pulls SDA low during the ninth clock */
+    int ack = clock_bit(bus, 1);
+    if (ack < 0)
+        return ack;
+    return ack ? I2C_ERR_NACK : I2C_OK;
+}
+
+int i2c_read_byte(struct i2c_bus *bus, int ack) {
+    unsigned int byte = 0;
+
+    for (int i = 0; i < 8; i++) {
+        int level = clock_bit(bus, 1);
+        if (level < 0)
+            return level;
+        byte = (byte << 1) | level;
+    }
+
+    int level = clock_bit(bus, !ack);
+    if (level < 0)
+        return level;
+    sda_release(bus);
+    return byte;
+}
+
+/* ===== Transactions ===== */
+
+/* Stop after a failure; the first error is the one reported */
+static int fail(struct i2c_bus *bus, int err) {
+    i2c_stop(bus);
+    return err;
+}
+
+int i2c_write(struct i2c_bus *bus, int addr, const unsigned char *buf, unsigned int n) {
+    return i2c_write_read(bus, addr, buf, n, 0, 0);
+}
+
+int i2c_read(struct i2c_bus *bus, int addr, unsigned char *buf, unsigned int n) {
+    return i2c_write_read(bus, addr, 0, 0, buf, n);
+}
+
+int i2c_probe(struct i2c_bus *bus, int addr) {
+    return i2c_write_read(bus, addr, 0, 0, 0, 0);
+}
+
+int i2c_write_read(struct i2c_bus *bus, int addr, const unsigned char *tx,
+                   unsigned int ntx, unsigned char *rx, unsigned int nrx) {
+    int err;
+
+    if (ntx || !nrx) {
+        if ((err = i2c_start(bus)) != I2C_OK)
+            return bus->active ? fail(bus, err) : err;
+        if ((err = i2c_write_byte(bus, (addr << 1) | 0)) != I2C_OK)
+            return fail(bus, err);
+        for (unsigned int i = 0; i < ntx; i++) {
+            if ((err = i2c_write_byte(bus, tx[i])) != I2C_OK)
+                return fail(bus, err);
+        }
+    }
+
+    if (nrx) {
+        if ((err = i2c_start(bus)) != I2C_OK)
+            return bus->active ? fail(bus, err) : err;
+        if ((err = i2c_write_byte(bus, (addr << 1) | 1)) != I2C_OK)
+            return fail(bus, err);
+        for (unsigned int i = 0; i < nrx; i++) {
+            /* NACK the last byte so the slave releases SDA for the stop */
+            int byte = i2c_read_byte(bus, i + 1 < nrx);
+            if (byte < 0)
+                return fail(bus, byte);
+            rx[i] = byte;
+        }
+    }
+
+    return i2c_stop(bus);
+}
@@ -0,0 +1,203 @@
+#include "irq.h"
+#include "dtekv-lib.h"
+#include "devices.h"
+#include "csr.h"
+#include "atomic.h"
+#include "trace.h"
+#include "utils.h"
+
+struct irq_entry {
+    irq_handler_t handler;
+    void *ctx;
+    int priority;
+    struct irq_stats stats;
+};
+
+static void irq_unhandled(unsigned int cause, void *ctx);
+
+/* Default handler for every cause, then the library's device handlers */
+#define IRQ_DEFAULT { irq_unhandled, 0, IRQ_PRIO_NORMAL, { 0, 0 } }
+
+static struct irq_entry irq_table[IRQ_MAX] = {
+    [0 ... IRQ_MAX - 1] = IRQ_DEFAULT,
+    [IRQ_TIMER]     = { handle_timer_irq, 0, IRQ_PRIO_NORMAL, { 0, 0 } },
+    [IRQ_SWITCHES]  = { handle_switch_irq, 0, IRQ_PRIO_NORMAL, { 0, 0 } },
+    [IRQ_BUTTON]    = { handle_button_irq, 0, IRQ_PRIO_NORMAL, { 0, 0 } },
+    [IRQ_JTAG_UART] = { handle_uart_irq, 0, IRQ_PRIO_NORMAL, { 0, 0 } },
+};
+
+/*
+ * Sources with a priority above each level. irq_dispatch() ANDs this with
+ * the live mie, so sources enabled behind irq_enable()'s back, such as by
+ * enable_interrupt(), nest as well.
+ */
+static unsigned int irq_mask_above[IRQ_NUM_PRIO];
+
+/* mie bits irq_dispatch() has masked for nested handlers, to put back after */
+static unsigned int irq_held;
+
+/* mepc and mscratch of the innermost handler running with interrupts on */
+static unsigned int irq_epc;
+static const unsigned int *irq_frame;
+
+volatile unsigned int irq_nesting;
+
+static void irq_unhandled(unsigned int cause, void *ctx) {
+    print("[IRQ] Unknown interrupt (cause=");
+    print_udec(cause);
+    print(")\n");
+}
+
+/* Recompute the nesting masks; called with interrupts masked */
+static void irq_update_masks(void) {
+    for (int p = 0; p < IRQ_NUM_PRIO; p++) {
+        unsigned int mask = 0;
+        for (unsigned int c = 0; c < IRQ_MAX; c++) {
+            if (irq_table[c].priority > p)
+                mask |= 1u << c;
+        }
+        irq_mask_above[p] = mask;
+    }
+}
+
+/* ===== Registration ===== */
+
+int irq_register(unsigned int cause, irq_handler_t handler, void *ctx, int priority) {
+    if (cause >= IRQ_MAX || priority < 0 || priority >= IRQ_NUM_PRIO)
+        return -1;
+
+    unsigned int s = irq_save();
+    struct irq_entry *e = &irq_table[cause];
+    e->handler = handler ? handler : irq_unhandled;
+    e->ctx = ctx;
+    e->priority = priority;
+    irq_update_masks();
+    irq_restore(s);
+    return 0;
+}
+
+void irq_enable(unsigned int cause) {
+    if (cause >= IRQ_MAX)
+        return;
+    csr_set(mie, 1u << cause);
+}
+
+void irq_disable(unsigned int cause) {
+    if (cause >= IRQ_MAX)
+        return;
+    unsigned int s = irq_save();
+    csr_clear(mie, 1u << cause);
+    irq_held &= ~(1u << cause);         /* Stays off when its masker returns */
+    irq_restore(s);
+}
+
+int irq_is_enabled(unsigned int cause) {
+    return cause < IRQ_MAX && ((csr_read(mie) | irq_held) & (1u << cause)) != 0;
+}
+
+/* ===== Dispatch ===== */
+
+void irq_dispatch(unsigned int cause) {
+    if (cause >= IRQ_MAX) {
+        irq_unhandled(cause, 0);
+        return;
+    }
+
+    struct irq_entry *e = &irq_table[cause];
+    unsigned int enabled = csr_read(mie);
+    unsigned int above = irq_mask_above[e->priority] & enabled;
+    unsigned int start = csr_read(mcycle);
+
+    TRACE_BEGIN(cause);
+    if (above == 0) {
+        e->handler(cause, e->ctx);
+    } else {
+        /*
+         * Let higher-priority sources in. A nested trap overwrites mepc,
+         * mstatus and the frame pointer in mscratch, so keep them, and
+         * mask everything else in mie.
+         */
+        unsigned int epc = csr_read(mepc);
+        unsigned int status = csr_read(mstatus);
+        unsigned int frame = csr_read(mscratch);
+        unsigned int held = enabled & ~above;
+        unsigned int outer_epc = irq_epc;
+        const unsigned int *outer_frame = irq_frame;
+
+        irq_epc = epc;
+        irq_frame = (const unsigned int *)(unsigned long)frame;
+        irq_held |= held;
+        csr_write(mie, above);
+        irq_nesting++;
+        csr_set(mstatus, MSTATUS_MIE);
+
+        e->handler(cause, e->ctx);
+
+        csr_clear(mstatus, MSTATUS_MIE);
+        irq_nesting--;
+        /* Only what was masked here, so the handler's irq_enable() and irq_disable() stick */
+        csr_set(mie, held & irq_held);
+        irq_held &= ~held;
+        irq_epc = outer_epc;
+        irq_frame = outer_frame;
+        csr_write(mscratch, frame);
+        csr_write(mepc, epc);
+        csr_write(mstatus, status);
+    }
+    TRACE_END(cause);
+
+    unsigned int cycles = csr_read(mcycle) - start;
+    e->stats.count++;
+    if (cycles > e->stats.max_cycles)
+        e->stats.max_cycles = cycles;
+}
+
+/*
+ * With MIE clear the handler cannot have been interrupted since its trap,
+ * so the CSRs are still its own; otherwise use what irq_dispatch() kept.
+ */
+unsigned int irq_interrupted_pc(void) {
+    return (csr_read(mstatus) & MSTATUS_MIE) ? irq_epc : csr_read(mepc);
+}
+
+const unsigned int *irq_interrupted_frame(void) {
+    if (csr_read(mstatus) & MSTATUS_MIE)
+        return irq_frame;
+    return (const unsigned int *)(unsigned long)csr_read(mscratch);
+}
+
+/* ===== Statistics ===== */
+
+void irq_get_stats(unsigned int cause, struct irq_stats *stats) {
+    if (cause >= IRQ_MAX) {
+        stats->count = 0;
+        stats->max_cycles = 0;
+        return;
+    }
+    unsigned int s = irq_save();
+    *stats = irq_table[cause].stats;
+    irq_restore(s);
+}
+
+void irq_reset_stats(void) {
+    unsigned int s = irq_save();
+    for (int c = 0; c < IRQ_MAX; c++) {
+        irq_table[c].stats.count = 0;
+        irq_table[c].stats.max_cycles = 0;
+    }
+    irq_restore(s);
+}
+
+void irq_report(void) {
+    unsigned int enabled = csr_read(mie);
+
+    printf("IRQ  prio  en  count       max cycles\n");
+    for (unsigned int c = 0; c < IRQ_MAX; c++) {
+        const struct irq_entry *e = &irq_table[c];
+        int is_enabled = (enabled >> c) & 1;
+        if (!is_enabled && e->stats.count == 0 && e->handler == irq_unhandled)
+            continue;
+        printf("%-4u %-5d %-3s %-11u %u\n", c, e->priority, is_enabled ? "on" : "off",
+               e->stats.count, e->stats.max_cycles);
+    }
+}
@@ -0,0 +1,244 @@
+#include "logic.h"
+#include "devices.h"
+#include "dtekv-lib.h"
+#include "atomic.h"
+#include "csr.h"
+#include "utils.h"
+
+/* Bytes per record in the dump: time, pins 0-31, pins 32-39 */
+#define DUMP_RECORD_SIZE 9
+#define DUMP_BATCH       16
+
+static struct logic_record records[LOGIC_MAX_RECORDS];
+
+static struct {
+    struct logic_config cfg;
+    volatile int state;
+    unsigned int first;             /* Ring index of the oldest record */
+    unsigned int count;
+    unsigned int post_left;         /* Records still allowed after the trigger */
+    unsigned int start;             /* mcycle when armed */
+    unsigned int trigger;           /* Ring index of the trigger record */
+    unsigned int trigger_time;
+    unsigned int end_time;
+    unsigned int samples;
+    unsigned int last[2];           /* Levels in the newest record */
+} la;
+
+/* ===== Capture ===== */
+
+void logic_arm(const struct logic_config *cfg) {
+    unsigned int s = irq_save();
+    la.cfg = *cfg;
+    la.cfg.trigger[0] &= GPIO_BANK_MASK;
+    la.cfg.trigger[1] &= GPIO_BANK_MASK;
+
+    /* The trigger record itself always fits after the pre-trigger records */
+    if (la.cfg.pre_records > LOGIC_MAX_RECORDS - 1)
+        la.cfg.pre_records = LOGIC_MAX_RECORDS - 1;
+    la.post_left = LOGIC_MAX_RECORDS - la.cfg.pre_records;
+    if (la.cfg.post_records && la.cfg.post_records < la.post_left)
+        la.post_left = la.cfg.post_records;
+
+    la.first = 0;
+    la.count = 0;
+    la.samples = 0;
+    la.trigger = LOGIC_NO_TRIGGER;
+    la.trigger_time = 0;
+    la.end_time = 0;
+    la.start = csr_read(mcycle);
+    la.state = (la.cfg.trigger[0] | la.cfg.trigger[1]) ? LOGIC_ARMED : LOGIC_TRIGGERED;
+    irq_restore(s);
+}
+
+static void finish(unsigned int time) {
+    la.end_time = time;
+    la.state = LOGIC_DONE;
+}
+
+static void fire_trigger(unsigned int index, unsigned int time) {
+    la.trigger = index;
+    la.trigger_time = time;
+    la.state = LOGIC_TRIGGERED;
+}
+
+int logic_sample(void) {
+    int state = la.state;
+    if (state != LOGIC_ARMED && state != LOGIC_TRIGGERED)
+        return 0;
+
+    unsigned int time = csr_read(mcycle) - la.start;
+    unsigned int pins0 = mmio_read32(GPIO_DATA(0)) & GPIO_BANK_MASK;
+    unsigned int pins1 = mmio_read32(GPIO_DATA(1)) & GPIO_BANK_MASK;
+    unsigned int changed0 = pins0 ^ la.last[0];
+    unsigned int changed1 = pins1 ^ la.last[1];
+    int baseline = la.samples++ == 0;
+
+    if (state == LOGIC_ARMED) {
+        if (la.cfg.timeout && time >= la.cfg.timeout) {
+            finish(time);
+            return 0;
+        }
+    } else if (la.cfg.duration && time - la.trigger_time >= la.cfg.duration) {
+        finish(time);
+        return 0;
+    }
+
+    /* Same levels as the newest record: fold into its run */
+    if (!baseline && !(changed0 | changed1))
+        return 1;
+    la.last[0] = pins0;
+    la.last[1] = pins1;
+
+    /* The first sample is the baseline and never triggers */
+    int fire = state == LOGIC_TRIGGERED ? la.trigger == LOGIC_NO_TRIGGER
+             : !baseline && ((changed0 & la.cfg.trigger[0]) | (changed1 & la.cfg.trigger[1]));
+
+    if (state == LOGIC_ARMED && !fire) {
+        if (la.cfg.pre_records == 0)
+            return 1;
+        if (la.count == la.cfg.pre_records) {
+            /* Pre-trigger ring is full: drop the oldest record */
+            if (++la.first == LOGIC_MAX_RECORDS)
+                la.first = 0;
+            la.count--;
+        }
+    }
+
+    unsigned int index = la.first + la.count;
+    if (index >= LOGIC_MAX_RECORDS)
+        index -= LOGIC_MAX_RECORDS;
+    records[index].time = time;
+    records[index].pins[0] = pins0;
+    records[index].pins[1] = pins1;
+    la.count++;
+
+    if (fire)
+        fire_trigger(index, time);
+
+    if (la.state == LOGIC_TRIGGERED && --la.post_left == 0) {
+        finish(time);
+        return 0;
+    }
+    return 1;
+}
+
+int logic_run(void) {
+    unsigned int s = irq_save();
+
+    /* Nothing can call logic_stop() with interrupts off: always end */
+    if (la.cfg.timeout == 0)
+        la.cfg.timeout = LOGIC_RUN_LIMIT;
+    if (la.cfg.duration == 0)
+        la.cfg.duration = LOGIC_RUN_LIMIT;
+
+    if (la.cfg.interval == 0) {
+        while (logic_sample())
+            ;
+    } else {
+        unsigned int next = csr_read(mcycle);
+        do {
+            while ((int)(csr_read(mcycle) - next) < 0)
+                ;
+            next += la.cfg.interval;
+        } while (logic_sample());
+    }
+    irq_restore(s);
+    return la.trigger == LOGIC_NO_TRIGGER ? -1 : 0;
+}
+
+int logic_capture(const struct logic_config *cfg) {
+    logic_arm(cfg);
+    return logic_run();
+}
+
+void logic_stop(void) {
+    unsigned int s = irq_save();
+    if (la.state == LOGIC_ARMED || la.state == LOGIC_TRIGGERED)
+        finish(csr_read(mcycle) - la.start);
+    irq_restore(s);
+}
+
+int logic_state(void) {
+    return la.state;
+}
+
+const struct logic_record *logic_get_record(unsigned int index) {
+    if (index >= la.count)
+        return 0;
+    index += la.first;
+    if (index >= LOGIC_MAX_RECORDS)
+        index -= LOGIC_MAX_RECORDS;
+    return &records[index];
+}
+
+/* ===== Output ===== */
+
+/* Trigger position counted from the oldest record */
+static unsigned int trigger_offset(void) {
+    if (la.trigger == LOGIC_NO_TRIGGER)
+        return LOGIC_NO_TRIGGER;
+    return la.trigger >= la.first ? la.trigger - la.first
+                                  : la.trigger + LOGIC_MAX_RECORDS - la.first;
+}
+
+static void put_word(unsigned char *p, unsigned int v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+void logic_dump(void) {
+    unsigned int header[7];
+    unsigned char batch[DUMP_BATCH * DUMP_RECORD_SIZE];
+
+    header[0] = LOGIC_MAGIC;
+    header[1] = CPU_CLOCK_HZ;
+    header[2] = la.cfg.interval;
+    header[3] = la.count;
+    header[4] = trigger_offset();
+    header[5] = la.end_time;
+    header[6] = la.samples;
+    uart_write((const char *)header, sizeof(header));
+
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < la.count; i++) {
+        const struct logic_record *r = logic_get_record(i);
+        unsigned char *p = &batch[n * DUMP_RECORD_SIZE];
+        put_word(p, r->time);
+        put_word(p + 4, r->pins[0] | (r->pins[1] << GPIO_BANK_PINS));
+        p[8] = r->pins[1] >> (32 - GPIO_BANK_PINS);
+        if (++n == DUMP_BATCH) {
+            uart_write((const char *)batch, sizeof(batch));
+            n = 0;
+        }
+    }
+    uart_write((const char *)batch, n * DUMP_RECORD_SIZE);
+    uart_flush();
+}
+
+void logic_get_stats(struct logic_stats *stats) {
+    unsigned int s = irq_save();
+    stats->state = la.state;
+    stats->records = la.count;
+    stats->samples = la.samples;
+    stats->trigger = trigger_offset();
+    stats->trigger_time = la.trigger_time;
+    stats->end_time = la.state == LOGIC_DONE ? la.end_time : csr_read(mcycle) - la.start;
+    irq_restore(s);
+}
+
+void logic_report(void) {
+    static const char *const state_names[] = {"idle", "armed", "triggered", "done"};
+    struct logic_stats st;
+
+    logic_get_stats(&st);
+    printf("Logic analyzer: %s, %u/%u records, %u samples in %u cycles",
+           state_names[st.state], st.records, LOGIC_MAX_RECORDS, st.samples, st.end_time);
+    if (st.samples)
+        printf(" (%u cycles/sample)", st.end_time / st.samples);
+    printf("\n");
+    if (st.trigger != LOGIC_NO_TRIGGER)
+        printf("  trigger at record %u, cycle %u\n", st.trigger, st.trigger_time);
+}
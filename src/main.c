@@ -19,7 +19,7 @@ int main(void) {
     printf("Switch state: 0x%x\n", sw);
 
     // Display number
-    display_number(0x123456);
+    display_number(0x123456, DISPLAY_HEX);
 
     // Dump registers for debugging
     reg_dump_all();
@@ -0,0 +1,139 @@
+#include "marquee.h"
+#include "devices.h"
+#include "timer.h"
+
+#define MARQUEE_BLINK 3     /* Internal mode for marquee_blink() */
+
+static unsigned char segments[MARQUEE_MAX_LEN];   /* Encoded text, left to right */
+static int length;
+static int mode;
+static int position;        /* Window offset into the padded text */
+static int direction;       /* MARQUEE_BOUNCE: +1 or -1 */
+static int blink_on;
+static unsigned char saved_frame[DISPLAY_COUNT];
+static struct soft_timer tick;
+static volatile int active;
+
+static const unsigned char blank_frame[DISPLAY_COUNT] = {
+    DISPLAY_BLANK, DISPLAY_BLANK, DISPLAY_BLANK,
+    DISPLAY_BLANK, DISPLAY_BLANK, DISPLAY_BLANK,
+};
+
+/* Encode text, folding each '.' into the previous digit's decimal point */
+static int encode(const char *text) {
+    int n = 0;
+    for (int i = 0; text[i] != '\0' && n < MARQUEE_MAX_LEN; i++) {
+        if (text[i] == '.' && n > 0 && (segments[n - 1] & DISPLAY_SEG_DP)) {
+            segments[n - 1] &= ~DISPLAY_SEG_DP;
+            continue;
+        }
+        unsigned char pattern = display_encode_char(text[i]);
+        if (pattern == DISPLAY_BLANK && text[i] != ' ' && text[i] != '.')
+            continue;   /* No glyph */
+        if (text[i] == '.')
+            pattern = DISPLAY_BLANK & ~DISPLAY_SEG_DP;
+        segments[n++] = pattern;
+    }
+    return n;
+}
+
+/* Show the window whose leftmost digit is text position first */
+static void show_window(int first) {
+    unsigned char frame[DISPLAY_COUNT];
+    for (int i = 0; i < DISPLAY_COUNT; i++) {
+        int index = first + (DISPLAY_COUNT - 1 - i);
+        frame[i] = (index >= 0 && index < length) ? segments[index] : DISPLAY_BLANK;
+    }
+    display_set_frame(frame);
+}
+
+/* ===== Timer Tick ===== */
+
+static void marquee_tick(struct soft_timer *t, void *ctx) {
+    switch (mode) {
+    case MARQUEE_ONCE:
+    case MARQUEE_LOOP:
+        /* Window starts fully right of the text and ends fully left of it */
+        position++;
+        if (position > length) {
+            if (mode == MARQUEE_ONCE) {
+                soft_timer_cancel(t);
+                active = 0;
+                return;
+            }
+            position = -DISPLAY_COUNT;
+        }
+        show_window(position);
+        break;
+
+    case MARQUEE_BOUNCE:
+        if (length > DISPLAY_COUNT) {
+            position += direction;
+            if (position <= 0 || position >= length - DISPLAY_COUNT)
+                direction = -direction;
+            show_window(position);
+        }
+        break;
+
+    case MARQUEE_BLINK:
+        blink_on = !blink_on;
+        display_set_frame(blink_on ? saved_frame : blank_frame);
+        break;
+    }
+}
+
+/* ===== Control ===== */
+
+int marquee_start(const char *text, unsigned int step_ms, int scroll_mode) {
+    /* Without the service the timer would start but never tick */
+    if (timer_service_mode() < 0)
+        return -1;
+    marquee_stop();
+
+    length = encode(text);
+    mode = scroll_mode;
+    direction = 1;
+    position = (mode == MARQUEE_BOUNCE) ? 0 : -DISPLAY_COUNT;
+    show_window(position);
+
+    active = 1;
+    soft_timer_init(&tick, marquee_tick, 0);
+    if (soft_timer_start(&tick, step_ms * 1000, step_ms * 1000) != 0) {
+        active = 0;
+        return -1;
+    }
+    return 0;
+}
+
+int marquee_blink(unsigned int period_ms) {
+    if (timer_service_mode() < 0)
+        return -1;
+    marquee_stop();
+
+    for (int i = 0; i < DISPLAY_COUNT; i++)
+        saved_frame[i] = display_get_segments(i);
+    mode = MARQUEE_BLINK;
+    blink_on = 1;
+
+    active = 1;
+    soft_timer_init(&tick, marquee_tick, 0);
+    /* Half a period on, half off */
+    if (soft_timer_start(&tick, period_ms * 500, period_ms * 500) != 0) {
+        active = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void marquee_stop(void) {
+    if (!active)
+        return;
+    soft_timer_cancel(&tick);
+    active = 0;
+    if (mode == MARQUEE_BLINK && !blink_on)
+        display_set_frame(saved_frame);
+}
+
+int marquee_active(void) {
+    return active;
+}
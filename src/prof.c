@@ -0,0 +1,224 @@
+#include "prof.h"
+#include "timer.h"
+#include "dtekv-lib.h"
+#include "atomic.h"
+#include "irq.h"
+#include "utils.h"
+
+extern char _text_begin[];
+extern char _text_end[];
+
+/* Entries per uart_write() in the dump, and buckets in prof_report() */
+#define DUMP_BATCH 16
+#define REPORT_TOP 8
+
+static unsigned int pc_hist[PROF_MAX_BUCKETS];
+static unsigned int caller_hist[PROF_MAX_BUCKETS];
+
+static struct {
+    struct soft_timer timer;
+    unsigned int base;              /* _text_begin */
+    unsigned int size;              /* Bytes covered by the buckets */
+    unsigned int shift;
+    unsigned int buckets;
+    unsigned int period;            /* Mean sampling period in cycles */
+    unsigned int rate_hz;
+    int flags;
+    unsigned int rand;              /* Dither state */
+    volatile int paused;            /* Set while dumping */
+    unsigned int samples;
+    unsigned int outside;
+} prof;
+
+/* ===== Sampling ===== */
+
+/* Period for the next sample: the mean +- 1/32, from a xorshift sequence */
+static unsigned int next_period(void) {
+    unsigned int x = prof.rand;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    prof.rand = x;
+
+    unsigned int span = prof.period / 16;
+    return prof.period - span / 2 + x % (span + 1);
+}
+
+/*
+ * Runs in the timer interrupt. Not from mepc and mscratch directly: with
+ * a higher-priority source enabled the handler runs with interrupts on,
+ * and a nested trap overwrites both.
+ */
+static void prof_sample(struct soft_timer *t, void *ctx) {
+    (void)ctx;
+
+    if (!prof.paused) {
+        unsigned int offset = irq_interrupted_pc() - prof.base;
+        if (offset < prof.size)
+            pc_hist[offset >> prof.shift]++;
+        else
+            prof.outside++;
+
+        if (prof.flags & PROF_CALLERS) {
+            unsigned int ra = *irq_interrupted_frame();
+            offset = ra - prof.base;
+            if (offset < prof.size)
+                caller_hist[offset >> prof.shift]++;
+        }
+        prof.samples++;
+    }
+
+    soft_timer_start_cycles(t, next_period(), 0);
+}
+
+int prof_start(unsigned int rate_hz, int flags) {
+    if (rate_hz == 0 || rate_hz > PROF_MAX_RATE)
+        return -1;
+
+    prof_stop();
+
+    prof.base = (unsigned int)_text_begin;
+    prof.size = (unsigned int)(_text_end - _text_begin);
+    prof.shift = 2;
+    while ((prof.size >> prof.shift) >= PROF_MAX_BUCKETS)
+        prof.shift++;
+    prof.buckets = (prof.size >> prof.shift) + 1;
+    prof.period = CPU_CLOCK_HZ / rate_hz;
+    prof.rate_hz = rate_hz;
+    prof.flags = flags;
+    prof.rand = 0x9E3779B9u;
+    prof.paused = 0;
+    prof_reset();
+
+    if (timer_service_mode() < 0)
+        timer_service_init(TIMER_MODE_TICKLESS);
+    soft_timer_init(&prof.timer, prof_sample, 0);
+    if (soft_timer_start_cycles(&prof.timer, next_period(), 0) != 0) {
+        prof.rate_hz = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void prof_stop(void) {
+    if (prof.rate_hz) {
+        soft_timer_cancel(&prof.timer);
+        prof.rate_hz = 0;
+    }
+}
+
+void prof_reset(void) {
+    unsigned int s = irq_save();
+    for (unsigned int i = 0; i < PROF_MAX_BUCKETS; i++) {
+        pc_hist[i] = 0;
+        caller_hist[i] = 0;
+    }
+    prof.samples = 0;
+    prof.outside = 0;
+    irq_restore(s);
+}
+
+/* ===== Results ===== */
+
+static unsigned int count_nonzero(const unsigned int *hist) {
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < prof.buckets; i++)
+        n += hist[i] != 0;
+    return n;
+}
+
+static void dump_hist(const unsigned int *hist) {
+    unsigned int batch[DUMP_BATCH * 2];
+    unsigned int n = 0;
+
+    for (unsigned int i = 0; i < prof.buckets; i++) {
+        if (hist[i] == 0)
+            continue;
+        batch[n * 2] = i;
+        batch[n * 2 + 1] = hist[i];
+        if (++n == DUMP_BATCH) {
+            uart_write((const char *)batch, sizeof(batch));
+            n = 0;
+        }
+    }
+    uart_write((const char *)batch, n * 2 * sizeof(batch[0]));
+}
+
+/* Sampling continues in the background but is not counted meanwhile */
+void prof_dump(void) {
+    unsigned int header[11];
+    int callers = (prof.flags & PROF_CALLERS) != 0;
+
+    prof.paused = 1;
+    header[0] = PROF_MAGIC;
+    header[1] = CPU_CLOCK_HZ;
+    header[2] = prof.rate_hz;
+    header[3] = prof.base;
+    header[4] = prof.shift;
+    header[5] = prof.buckets;
+    header[6] = prof.samples;
+    header[7] = prof.outside;
+    header[8] = prof.flags;
+    header[9] = count_nonzero(pc_hist);
+    header[10] = callers ? count_nonzero(caller_hist) : 0;
+    uart_write((const char *)header, sizeof(header));
+
+    dump_hist(pc_hist);
+    if (callers)
+        dump_hist(caller_hist);
+    uart_flush();
+    prof.paused = 0;
+}
+
+void prof_get_stats(struct prof_stats *stats) {
+    unsigned int s = irq_save();
+    stats->samples = prof.samples;
+    stats->outside = prof.outside;
+    stats->rate_hz = prof.rate_hz;
+    stats->shift = prof.shift;
+    stats->buckets = prof.buckets;
+    irq_restore(s);
+}
+
+/*
+ * Share of the samples in percent, without overflowing on long runs or
+ * dividing 64-bit values (no libgcc). Rounding samples / 100 up keeps
+ * the result at or below 100.
+ */
+static unsigned int percent(unsigned int count, unsigned int samples) {
+    if (samples >= 100)
+        return count / (samples / 100 + (samples % 100 != 0));
+    return count * 100 / samples;
+}
+
+/* The REPORT_TOP fullest buckets, by repeated scans below the last count */
+void prof_report(void) {
+    struct prof_stats st;
+    unsigned int limit = ~0u, last = 0;
+
+    prof_get_stats(&st);
+    printf("Profiler: %s, %u Hz, %u samples (%u outside text), %u-byte buckets\n",
+           st.rate_hz ? "running" : "stopped", st.rate_hz, st.samples, st.outside,
+           1u << st.shift);
+    if (st.samples == 0)
+        return;
+
+    prof.paused = 1;
+    for (int shown = 0; shown < REPORT_TOP; shown++) {
+        unsigned int best = 0, best_count = 0;
+        for (unsigned int i = 0; i < st.buckets; i++) {
+            unsigned int c = pc_hist[i];
+            if ((c < limit || (c == limit && i > last)) && c > best_count) {
+                best = i;
+                best_count = c;
+            }
+        }
+        if (best_count == 0)
+            break;
+        printf("  0x%08x  %6u  %3u%%\n", prof.base + (best << st.shift), best_count,
+               percent(best_count, st.samples));
+        limit = best_count;
+        last = best;
+    }
+    prof.paused = 0;
+}
@@ -0,0 +1,270 @@
+#include "sched.h"
+#include "timer.h"
+#include "irq.h"
+#include "csr.h"
+#include "atomic.h"
+#include "utils.h"
+
+/* Task stack region from the linker script */
+extern char _task_stack_begin[];
+extern char _task_stack_end[];
+extern char _stack_end[];
+
+/* Context frame built by ctx_switch (context.S), in words */
+#define CTX_RA       0
+#define CTX_S0       1
+#define CTX_S1       2
+#define CTX_MEPC     13
+#define CTX_MSTATUS  14
+#define CTX_WORDS    16
+
+/* Unused stack words hold this so the high-water mark can be measured */
+#define STACK_FILL 0xCAFEF00Du
+
+#define STACK_ALIGN 16
+
+struct task {
+    unsigned long sp;               /* Saved stack pointer while switched out */
+    const char *name;
+    unsigned int *stack_base;       /* Lowest stack word */
+    unsigned int stack_size;        /* Bytes */
+    int state;
+    unsigned long long wake_at;     /* TASK_SLEEPING: mcycle deadline */
+    struct event *wait;             /* TASK_WAITING: event */
+    unsigned int switches;          /* Times this task was switched in */
+};
+
+void task_trampoline(void);
+
+static struct task tasks[SCHED_MAX_TASKS];
+static int task_count;
+static struct task *current;
+static char *stack_next;            /* Next free byte of the task stack region */
+static unsigned long long idle_cycles;
+
+/* Set when the time slice expires; checked on every interrupt exit */
+volatile int sched_need_resched;
+static struct soft_timer slice_timer;
+
+/* ===== Scheduling ===== */
+
+/* Check whether a task can run, consuming its event if it was waiting */
+static int task_runnable(struct task *t, unsigned long long now) {
+    switch (t->state) {
+    case TASK_READY:
+        return 1;
+    case TASK_SLEEPING:
+        if (now < t->wake_at)
+            return 0;
+        break;
+    case TASK_WAITING:
+        if (t->wait->count == 0)
+            return 0;
+        t->wait->count--;
+        t->wait = 0;
+        break;
+    default:
+        return 0;
+    }
+    t->state = TASK_READY;
+    return 1;
+}
+
+/* Pick the next runnable task after the current one and switch to it */
+static void schedule(void) {
+    unsigned int s = irq_save();
+    struct task *prev = current;
+    struct task *next = 0;
+    int first = prev - tasks;
+
+    for (;;) {
+        unsigned long long now = get_cycles64();
+        for (int n = 1; n <= task_count; n++) {
+            int i = first + n;
+            if (i >= task_count)
+                i -= task_count;
+            if (task_runnable(&tasks[i], now)) {
+                next = &tasks[i];
+                break;
+            }
+        }
+        if (next)
+            break;
+
+        /* Idle: let interrupt handlers run so they can signal events */
+        irq_restore(s);
+        unsigned long long idle_start = get_cycles64();
+        while (get_cycles64() - idle_start < 64)
+            ;
+        s = irq_save();
+        idle_cycles += get_cycles64() - idle_start;
+    }
+
+    if (next != prev) {
+        next->switches++;
+        current = next;
+        ctx_switch(&prev->sp, next->sp);
+    }
+    irq_restore(s);
+}
+
+void sched_init(void) {
+    struct task *t = &tasks[0];
+
+    /* main() keeps the boot stack above the task stack region */
+    t->name = "main";
+    t->stack_base = (unsigned int *)_task_stack_end;
+    t->stack_size = _stack_end - _task_stack_end;
+    t->state = TASK_READY;
+    t->switches = 1;
+
+    task_count = 1;
+    current = t;
+    stack_next = _task_stack_begin;
+}
+
+int task_create(const char *name, void (*entry)(void *arg), void *arg,
+                unsigned int stack_size) {
+    if (stack_size < SCHED_MIN_STACK)
+        stack_size = SCHED_MIN_STACK;
+    stack_size = (stack_size + STACK_ALIGN - 1) & ~(STACK_ALIGN - 1);
+
+    unsigned int s = irq_save();
+    if (task_count >= SCHED_MAX_TASKS ||
+        stack_size > (unsigned long)(_task_stack_end - stack_next)) {
+        irq_restore(s);
+        return -1;
+    }
+    int id = task_count;
+    struct task *t = &tasks[id];
+    t->stack_base = (unsigned int *)stack_next;
+    stack_next += stack_size;
+    irq_restore(s);
+
+    for (unsigned int i = 0; i < stack_size / 4; i++)
+        t->stack_base[i] = STACK_FILL;
+
+    /* Initial frame: the first ctx_switch "returns" into the trampoline */
+    unsigned int *frame = (unsigned int *)((char *)t->stack_base + stack_size) - CTX_WORDS;
+    frame[CTX_RA] = (unsigned long)task_trampoline;
+    frame[CTX_S0] = (unsigned long)entry;
+    frame[CTX_S1] = (unsigned long)arg;
+    frame[CTX_MEPC] = 0;
+    frame[CTX_MSTATUS] = csr_read(mstatus);
+
+    t->sp = (unsigned long)frame;
+    t->name = name;
+    t->stack_size = stack_size;
+    t->wait = 0;
+    t->switches = 0;
+    t->state = TASK_READY;
+
+    /* Publish last so the scheduler never sees a half-built task */
+    s = irq_save();
+    task_count++;
+    irq_restore(s);
+    return id;
+}
+
+void task_exit(void) {
+    /* The stack is not reclaimed; task stacks are carved out once */
+    current->state = TASK_DONE;
+    schedule();
+    for (;;)
+        ;
+}
+
+int task_current(void) {
+    return current - tasks;
+}
+
+/* ===== Blocking Primitives ===== */
+
+void yield(void) {
+    schedule();
+}
+
+void sleep_until(unsigned long long cycles) {
+    current->wake_at = cycles;
+    current->state = TASK_SLEEPING;
+    schedule();
+}
+
+void task_sleep_us(unsigned int us) {
+    sleep_until(get_cycles64() + us_to_cycles(us));
+}
+
+void event_wait(struct event *ev) {
+    unsigned int s = irq_save();
+    if (ev->count) {
+        ev->count--;
+        irq_restore(s);
+        return;
+    }
+    current->wait = ev;
+    current->state = TASK_WAITING;
+    irq_restore(s);
+    schedule();
+}
+
+void event_signal(struct event *ev) {
+    unsigned int s = irq_save();
+    ev->count++;
+    irq_restore(s);
+}
+
+/* ===== Preemption ===== */
+
+static void slice_expired(struct soft_timer *t, void *ctx) {
+    sched_need_resched = 1;
+}
+
+void sched_set_preempt(unsigned int slice_us) {
+    if (slice_us == 0) {
+        soft_timer_cancel(&slice_timer);
+        sched_need_resched = 0;
+        return;
+    }
+    soft_timer_init(&slice_timer, slice_expired, 0);
+    soft_timer_start(&slice_timer, slice_us, slice_us);
+}
+
+/*
+ * Called on interrupt exit. Switching here leaves the interrupted task's
+ * trap frame on its own stack; it finishes the handler and returns with
+ * mret when it is next scheduled. Nested handlers never switch, since the
+ * outer handler has narrowed mie.
+ */
+void sched_irq_exit(void) {
+    if (sched_need_resched && current && irq_nesting == 0) {
+        sched_need_resched = 0;
+        schedule();
+    }
+}
+
+/* ===== Diagnostics ===== */
+
+static unsigned int stack_used(const struct task *t) {
+    unsigned int words = t->stack_size / 4;
+    unsigned int i = 0;
+    while (i < words && t->stack_base[i] == STACK_FILL)
+        i++;
+    return (words - i) * 4;
+}
+
+void sched_report(void) {
+    static const char *const state_names[] = {"ready", "sleep", "wait", "done"};
+
+    printf("Tasks: %d/%d, idle %llu cycles\n", task_count, SCHED_MAX_TASKS, idle_cycles);
+    for (int i = 0; i < task_count; i++) {
+        const struct task *t = &tasks[i];
+        printf("  %d %-10s %-5s switches %-8u", i, t->name, state_names[t->state], t->switches);
+        if (i == 0) {
+            printf(" stack %u bytes\n", t->stack_size);
+        } else {
+            unsigned int used = stack_used(t);
+            printf(" stack %u/%u bytes%s\n", used, t->stack_size,
+                   t->stack_base[0] != STACK_FILL ? " OVERFLOW" : "");
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#include "softuart.h"
+#include "devices.h"
+#include "atomic.h"
+#include "delay.h"
+#include "csr.h"
+#include "utils.h"
+
+/* ===== Setup ===== */
+
+void softuart_set_baud(struct softuart *u, unsigned int baud) {
+    u->bit_period = (CPU_CLOCK_HZ + baud / 2) / baud;
+}
+
+int softuart_init(struct softuart *u, int tx, int rx, unsigned int baud) {
+    if (baud == 0 ||
+        !((tx >= 0 && tx < GPIO_PIN_COUNT) || tx == SOFTUART_NO_PIN) ||
+        !((rx >= 0 && rx < GPIO_PIN_COUNT) || rx == SOFTUART_NO_PIN))
+        return -1;
+
+    u->tx = tx;
+    u->rx = rx;
+    u->tx_bank = tx == SOFTUART_NO_PIN ? 0 : GPIO_PIN_BANK(tx);
+    u->tx_mask = tx == SOFTUART_NO_PIN ? 0 : GPIO_PIN_MASK(tx);
+    u->rx_bank = rx == SOFTUART_NO_PIN ? 0 : GPIO_PIN_BANK(rx);
+    u->rx_mask = rx == SOFTUART_NO_PIN ? 0 : GPIO_PIN_MASK(rx);
+    softuart_set_baud(u, baud);
+
+    /* Idle line is high */
+    gpio_port_set(u->tx_bank, u->tx_mask);
+    gpio_port_set_direction(u->tx_bank, u->tx_mask, ~0u);
+    gpio_port_set_direction(u->rx_bank, u->rx_mask, 0);
+    u->deadline = csr_read(mcycle);
+    return 0;
+}
+
+/* ===== Transmit ===== */
+
+static void send_frame(struct softuart *u, unsigned int c) {
+    unsigned int bits = c << 1;     /* Start bit (0), then data LSB first */
+
+    /* Let the previous stop bit finish with interrupts still enabled */
+    if (u->deadline - csr_read(mcycle) <= u->bit_period)
+        delay_until(u->deadline);
+
+    unsigned int s = irq_save();
+    unsigned int deadline = csr_read(mcycle);
+    for (int i = 0; i < 9; i++) {
+        gpio_port_write(u->tx_bank, u->tx_mask, -(bits & 1));
+        bits >>= 1;
+        deadline += u->bit_period;
+        delay_until(deadline);
+    }
+    gpio_port_set(u->tx_bank, u->tx_mask);
+    irq_restore(s);
+    u->deadline = deadline + u->bit_period;
+}
+
+void softuart_putc(struct softuart *u, unsigned char c) {
+    softuart_write(u, &c, 1);
+}
+
+void softuart_write(struct softuart *u, const unsigned char *buf, unsigned int n) {
+    if (!u->tx_mask)
+        return;
+    for (unsigned int i = 0; i < n; i++)
+        send_frame(u, buf[i]);
+    if (n)
+        delay_until(u->deadline);
+}
+
+/* ===== Receive ===== */
+
+static inline int rx_level(const struct softuart *u) {
+    return (mmio_read32(GPIO_DATA(u->rx_bank)) & u->rx_mask) != 0;
+}
+
+/* Call with interrupts held off */
+static int receive_frame(struct softuart *u, unsigned int timeout) {
+    unsigned int start = csr_read(mcycle);
+    unsigned int edge;
+
+    for (;;) {
+        /* Falling edge of the start bit */
+        while (rx_level(u)) {
+            if (timeout && csr_read(mcycle) - start > timeout)
+                return SOFTUART_TIMEOUT;
+        }
+        edge = csr_read(mcycle);
+
+        /* A start bit still low at its centre; otherwise it was a glitch */
+        delay_until(edge + u->bit_period / 2);
+        if (!rx_level(u))
+            break;
+    }
+
+    unsigned int deadline = edge + u->bit_period / 2;
+    unsigned int c = 0;
+    for (int i = 0; i < 8; i++) {
+        deadline += u->bit_period;
+        delay_until(deadline);
+        c |= rx_level(u) << i;
+    }
+
+    deadline += u->bit_period;
+    delay_until(deadline);
+    return rx_level(u) ? (int)c : SOFTUART_FRAMING;
+}
+
+int softuart_getc(struct softuart *u, unsigned int timeout_us) {
+    if (!u->rx_mask)
+        return SOFTUART_TIMEOUT;
+
+    unsigned int timeout = (unsigned int)us_to_cycles(timeout_us);
+    unsigned int s = irq_save();
+    int c = receive_frame(u, timeout);
+    irq_restore(s);
+    return c;
+}
+
+unsigned int softuart_read(struct softuart *u, unsigned char *buf, unsigned int n,
+                           unsigned int timeout_us) {
+    if (!u->rx_mask)
+        return 0;
+
+    /* Interrupts stay off between frames so back-to-back bytes are not missed */
+    unsigned int timeout = (unsigned int)us_to_cycles(timeout_us);
+    unsigned int s = irq_save();
+    unsigned int i;
+    for (i = 0; i < n; i++) {
+        int c = receive_frame(u, timeout);
+        if (c < 0)
+            break;
+        buf[i] = c;
+    }
+    irq_restore(s);
+    return i;
+}
@@ -0,0 +1,142 @@
+#include "spi.h"
+#include "devices.h"
+#include "delay.h"
+#include "csr.h"
+#include "utils.h"
+
+/* ===== Setup ===== */
+
+static int pin_ok(int pin, int optional) {
+    return (pin >= 0 && pin < GPIO_PIN_COUNT) || (optional && pin == SPI_NO_PIN);
+}
+
+void spi_set_rate(struct spi_bus *bus, unsigned int hz) {
+    /* Round the phase up so the clock never runs faster than asked */
+    bus->half_period = hz ? (CPU_CLOCK_HZ + 2 * hz - 1) / (2 * hz) : 0;
+}
+
+int spi_init(struct spi_bus *bus, int sck, int mosi, int miso, int cs,
+             int mode, unsigned int hz) {
+    if (!pin_ok(sck, 0) || !pin_ok(mosi, 1) || !pin_ok(miso, 1) || !pin_ok(cs, 1) ||
+        (mode & ~(SPI_MODE3 | SPI_LSB_FIRST)))
+        return -1;
+
+    bus->sck = sck;
+    bus->mosi = mosi;
+    bus->miso = miso;
+    bus->cs = cs;
+    bus->mode = mode;
+    bus->sck_bank = GPIO_PIN_BANK(sck);
+    bus->sck_mask = GPIO_PIN_MASK(sck);
+
+    /* A missing pin gets an empty mask on the SCK bank, so it costs nothing */
+    bus->mosi_bank = mosi == SPI_NO_PIN ? bus->sck_bank : GPIO_PIN_BANK(mosi);
+    bus->mosi_mask = mosi == SPI_NO_PIN ? 0 : GPIO_PIN_MASK(mosi);
+    bus->miso_bank = miso == SPI_NO_PIN ? bus->sck_bank : GPIO_PIN_BANK(miso);
+    bus->miso_mask = miso == SPI_NO_PIN ? 0 : GPIO_PIN_MASK(miso);
+    spi_set_rate(bus, hz);
+
+    /* Set levels before enabling the drivers so nothing glitches */
+    gpio_port_write(bus->sck_bank, bus->sck_mask, (mode & 2) ? ~0u : 0);
+    gpio_port_set_direction(bus->sck_bank, bus->sck_mask, ~0u);
+    gpio_port_set_direction(bus->mosi_bank, bus->mosi_mask, ~0u);
+    gpio_port_set_direction(bus->miso_bank, bus->miso_mask, 0);
+    if (cs != SPI_NO_PIN) {
+        gpio_write(cs, 1);
+        gpio_set_direction(cs, 1);
+    }
+    return 0;
+}
+
+void spi_select(struct spi_bus *bus) {
+    if (bus->cs != SPI_NO_PIN)
+        gpio_write(bus->cs, 0);
+}
+
+void spi_deselect(struct spi_bus *bus) {
+    if (bus->cs != SPI_NO_PIN)
+        gpio_write(bus->cs, 1);
+}
+
+/* ===== Bit Engine ===== */
+
+/* Drive SCK and MOSI (levels as all-ones/zero); one store on a shared bank */
+static inline void drive(const struct spi_bus *bus, unsigned int sck, unsigned int mosi) {
+    if (bus->mosi_bank == bus->sck_bank) {
+        gpio_port_write(bus->sck_bank, bus->sck_mask | bus->mosi_mask,
+                        (sck & bus->sck_mask) | (mosi & bus->mosi_mask));
+    } else {
+        gpio_port_write(bus->mosi_bank, bus->mosi_mask, mosi);
+        gpio_port_write(bus->sck_bank, bus->sck_mask, sck);
+    }
+}
+
+static inline unsigned int sample(const struct spi_bus *bus) {
+    return (mmio_read32(GPIO_DATA(bus->miso_bank)) & bus->miso_mask) != 0;
+}
+
+static inline unsigned int reverse8(unsigned int v) {
+    v = ((v & 0x0F) << 4) | ((v & 0xF0) >> 4);
+    v = ((v & 0x33) << 2) | ((v & 0xCC) >> 2);
+    return ((v & 0x55) << 1) | ((v & 0xAA) >> 1);
+}
+
+static unsigned int shift_byte(const struct spi_bus *bus, unsigned int out,
+                               unsigned int *deadline) {
+    unsigned int idle = (bus->mode & 2) ? ~0u : 0;
+    unsigned int half = bus->half_period;
+    unsigned int in = 0;
+    unsigned int mosi = 0;
+
+    /* The loop always sends bit 7 first */
+    if (bus->mode & SPI_LSB_FIRST)
+        out = reverse8(out);
+
+    for (int i = 7; i >= 0; i--) {
+        mosi = -((out >> i) & 1);
+        if (bus->mode & 1) {
+            /* CPHA 1: data changes on the leading edge, sampled on the trailing */
+            drive(bus, ~idle, mosi);
+            delay_pace(deadline, half);
+            drive(bus, idle, mosi);
+            in = (in << 1) | sample(bus);
+            delay_pace(deadline, half);
+        } else {
+            /* CPHA 0: data set up while idle, sampled on the leading edge */
+            drive(bus, idle, mosi);
+            delay_pace(deadline, half);
+            drive(bus, ~idle, mosi);
+            in = (in << 1) | sample(bus);
+            delay_pace(deadline, half);
+        }
+    }
+    if (!(bus->mode & 1))
+        drive(bus, idle, mosi);     /* Trailing edge of the last bit */
+
+    return (bus->mode & SPI_LSB_FIRST) ? reverse8(in) : in;
+}
+
+/* ===== Transfers ===== */
+
+unsigned char spi_transfer_byte(struct spi_bus *bus, unsigned char out) {
+    unsigned int deadline = csr_read(mcycle);
+    return shift_byte(bus, out, &deadline);
+}
+
+void spi_transfer(struct spi_bus *bus, unsigned char *buf, unsigned int n) {
+    unsigned int deadline = csr_read(mcycle);
+    for (unsigned int i = 0; i < n; i++)
+        buf[i] = shift_byte(bus, buf[i], &deadline);
+}
+
+void spi_write(struct spi_bus *bus, const unsigned char *buf, unsigned int n) {
+    unsigned int deadline = csr_read(mcycle);
+    for (unsigned int i = 0; i < n; i++)
+        shift_byte(bus, buf[i], &deadline);
+}
+
+void spi_read(struct spi_bus *bus, unsigned char *buf, unsigned int n) {
+    unsigned int deadline = csr_read(mcycle);
+    for (unsigned int i = 0; i < n; i++)
+        buf[i] = shift_byte(bus, 0xFF, &deadline);
+}
@@ -0,0 +1,235 @@
+#include "strmem.h"
+
+/*
+ * Word-at-a-time memory and string routines.
+ *
+ * Misaligned heads and tails are handled a byte at a time, the bulk is
+ * moved in aligned 32-bit words (unrolled by four) so no access ever
+ * traps on misalignment. Word reads past the end of a string never cross
+ * an aligned word, so they cannot touch unmapped memory.
+ *
+ * This file is built with -fno-tree-loop-distribute-patterns so GCC does
+ * not turn the loops below back into calls to memcpy/memset.
+ */
+
+typedef unsigned int __attribute__((__may_alias__)) word_t;
+
+#define ONES  0x01010101u
+#define HIGHS 0x80808080u
+
+/* Non-zero if any byte of v is zero */
+#define HAS_ZERO(v) (((v) - ONES) & ~(v) & HIGHS)
+
+#define IS_ALIGNED(p) ((((unsigned long)(p)) & 3) == 0)
+
+/* ===== Memory Blocks ===== */
+
+void *memcpy(void *dest, const void *src, size_t n) {
+    unsigned char *d = dest;
+    const unsigned char *s = src;
+
+    if (n < 8) {
+        while (n--)
+            *d++ = *s++;
+        return dest;
+    }
+
+    /* Head: align the destination */
+    while (!IS_ALIGNED(d)) {
+        *d++ = *s++;
+        n--;
+    }
+
+    word_t *dw = (word_t *)d;
+    unsigned int shift = ((unsigned long)s & 3) * 8;
+
+    if (shift == 0) {
+        const word_t *sw = (const word_t *)s;
+        for (; n >= 16; n -= 16) {
+            word_t a = sw[0], b = sw[1], c = sw[2], e = sw[3];
+            dw[0] = a;
+            dw[1] = b;
+            dw[2] = c;
+            dw[3] = e;
+            dw += 4;
+            sw += 4;
+        }
+        for (; n >= 4; n -= 4)
+            *dw++ = *sw++;
+        s = (const unsigned char *)sw;
+    } else {
+        /* Source misaligned: merge neighbouring aligned words */
+        const word_t *sw = (const word_t *)(s - shift / 8);
+        word_t lo = *sw++;
+        for (; n >= 4; n -= 4) {
+            word_t hi = *sw++;
+            *dw++ = (lo >> shift) | (hi << (32 - shift));
+            lo = hi;
+        }
+        s = (const unsigned char *)sw - 4 + shift / 8;
+    }
+
+    /* Tail */
+    d = (unsigned char *)dw;
+    while (n--)
+        *d++ = *s++;
+    return dest;
+}
+
+void *memmove(void *dest, const void *src, size_t n) {
+    unsigned char *d = dest;
+    const unsigned char *s = src;
+
+    /* Forward copy is safe unless dest starts inside src */
+    if (d <= s || d >= s + n)
+        return memcpy(dest, src, n);
+
+    d += n;
+    s += n;
+
+    if (((unsigned long)d & 3) == ((unsigned long)s & 3)) {
+        while (n && !IS_ALIGNED(d)) {
+            *--d = *--s;
+            n--;
+        }
+        word_t *dw = (word_t *)d;
+        const word_t *sw = (const word_t *)s;
+        for (; n >= 4; n -= 4)
+            *--dw = *--sw;
+        d = (unsigned char *)dw;
+        s = (const unsigned char *)sw;
+    }
+
+    while (n--)
+        *--d = *--s;
+    return dest;
+}
+
+void *memset(void *dest, int c, size_t n) {
+    unsigned char *d = dest;
+    unsigned char b = (unsigned char)c;
+
+    if (n < 8) {
+        while (n--)
+            *d++ = b;
+        return dest;
+    }
+
+    while (!IS_ALIGNED(d)) {
+        *d++ = b;
+        n--;
+    }
+
+    word_t w = b * ONES;
+    word_t *dw = (word_t *)d;
+    for (; n >= 16; n -= 16) {
+        dw[0] = w;
+        dw[1] = w;
+        dw[2] = w;
+        dw[3] = w;
+        dw += 4;
+    }
+    for (; n >= 4; n -= 4)
+        *dw++ = w;
+
+    d = (unsigned char *)dw;
+    while (n--)
+        *d++ = b;
+    return dest;
+}
+
+int memcmp(const void *s1, const void *s2, size_t n) {
+    const unsigned char *a = s1;
+    const unsigned char *b = s2;
+
+    if (IS_ALIGNED(a) && IS_ALIGNED(b)) {
+        const word_t *aw = (const word_t *)a;
+        const word_t *bw = (const word_t *)b;
+        while (n >= 4 && *aw == *bw) {
+            aw++;
+            bw++;
+            n -= 4;
+        }
+        a = (const unsigned char *)aw;
+        b = (const unsigned char *)bw;
+    }
+
+    /* Byte loop finds the first differing byte */
+    for (; n; n--, a++, b++) {
+        if (*a != *b)
+            return *a - *b;
+    }
+    return 0;
+}
+
+/* ===== Strings ===== */
+
+/* String length */
+int strlen(const char *s) {
+    const char *p = s;
+
+    while (!IS_ALIGNED(p)) {
+        if (*p == '\0')
+            return p - s;
+        p++;
+    }
+
+    const word_t *w = (const word_t *)p;
+    while (!HAS_ZERO(*w))
+        w++;
+
+    p = (const char *)w;
+    while (*p != '\0')
+        p++;
+    return p - s;
+}
+
+/* String comparison */
+int strcmp(const char *s1, const char *s2) {
+    if (((unsigned long)s1 & 3) == ((unsigned long)s2 & 3)) {
+        while (!IS_ALIGNED(s1)) {
+            if (*s1 == '\0' || *s1 != *s2)
+                return *(unsigned char *)s1 - *(unsigned char *)s2;
+            s1++;
+            s2++;
+        }
+        const word_t *w1 = (const word_t *)s1;
+        const word_t *w2 = (const word_t *)s2;
+        while (*w1 == *w2 && !HAS_ZERO(*w1)) {
+            w1++;
+            w2++;
+        }
+        s1 = (const char *)w1;
+        s2 = (const char *)w2;
+    }
+
+    while (*s1 && (*s1 == *s2)) {
+        s1++;
+        s2++;
+    }
+    return *(unsigned char *)s1 - *(unsigned char *)s2;
+}
+
+/* String copy */
+void strcpy(char *dest, const char *src) {
+    if (((unsigned long)dest & 3) == ((unsigned long)src & 3)) {
+        while (!IS_ALIGNED(src)) {
+            if ((*dest++ = *src++) == '\0')
+                return;
+        }
+        word_t *dw = (word_t *)dest;
+        const word_t *sw = (const word_t *)src;
+        while (!HAS_ZERO(*sw))
+            *dw++ = *sw++;
+        dest = (char *)dw;
+        src = (const char *)sw;
+    }
+
+    while ((*dest++ = *src++) != '\0')
+        ;
+}
+
+/* String concatenation */
+void strcat(char *dest, const char *src) {
+    strcpy(dest + strlen(dest), src);
+}
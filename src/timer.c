@@ -0,0 +1,196 @@
+#include "timer.h"
+#include "devices.h"
+#include "atomic.h"
+#include "irq.h"
+#include "utils.h"
+
+/* Shortest one-shot period, so a near deadline cannot be missed */
+#define TIMER_MIN_PERIOD 64
+#define TIMER_MAX_PERIOD 0xFFFFFFFFu
+
+static struct soft_timer *heap[TIMER_MAX];
+static int heap_count;
+static int service_mode = -1;       /* -1 until timer_service_init() */
+
+/* ===== Hardware Timer ===== */
+
+static void hw_timer_program(unsigned int period, unsigned short control) {
+    mmio_write16(TIMER_CONTROL, TIMER_CTRL_STOP);
+    mmio_write16(TIMER_STATUS, 0);
+    mmio_write16(TIMER_PERIODL, period & 0xFFFF);
+    mmio_write16(TIMER_PERIODH, period >> 16);
+    mmio_write16(TIMER_CONTROL, control | TIMER_CTRL_ITO | TIMER_CTRL_START);
+}
+
+/* Tickless mode: arm a one-shot for the earliest deadline. Lock held. */
+static void hw_timer_rearm(void) {
+    if (service_mode != TIMER_MODE_TICKLESS)
+        return;
+    if (heap_count == 0) {
+        mmio_write16(TIMER_CONTROL, TIMER_CTRL_STOP);
+        return;
+    }
+
+    unsigned long long now = get_cycles64();
+    unsigned long long deadline = heap[0]->deadline;
+    unsigned long long delta = deadline > now ? deadline - now : 0;
+
+    if (delta < TIMER_MIN_PERIOD)
+        delta = TIMER_MIN_PERIOD;
+    if (delta > TIMER_MAX_PERIOD)
+        delta = TIMER_MAX_PERIOD;   /* Long waits take several one-shots */
+    hw_timer_program((unsigned int)delta, 0);
+}
+
+/* ===== Min-Heap ===== */
+
+static inline void heap_place(struct soft_timer *t, int i) {
+    heap[i] = t;
+    t->heap_index = i;
+}
+
+static void heap_sift_up(int i) {
+    struct soft_timer *t = heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap[parent]->deadline <= t->deadline)
+            break;
+        heap_place(heap[parent], i);
+        i = parent;
+    }
+    heap_place(t, i);
+}
+
+static void heap_sift_down(int i) {
+    struct soft_timer *t = heap[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= heap_count)
+            break;
+        if (child + 1 < heap_count && heap[child + 1]->deadline < heap[child]->deadline)
+            child++;
+        if (t->deadline <= heap[child]->deadline)
+            break;
+        heap_place(heap[child], i);
+        i = child;
+    }
+    heap_place(t, i);
+}
+
+static void heap_remove(struct soft_timer *t) {
+    int i = t->heap_index;
+    struct soft_timer *last = heap[--heap_count];
+    t->heap_index = -1;
+    if (last == t)
+        return;
+
+    heap_place(last, i);
+    if (i > 0 && heap[(i - 1) / 2]->deadline > last->deadline) {
+        heap_sift_up(i);
+    } else {
+        heap_sift_down(i);
+    }
+}
+
+/* ===== Service ===== */
+
+void timer_service_init(int mode) {
+    unsigned int s = irq_save();
+    service_mode = mode;
+    if (mode == TIMER_MODE_TICK) {
+        hw_timer_program((unsigned int)us_to_cycles(TIMER_TICK_US), TIMER_CTRL_CONT);
+    } else {
+        hw_timer_rearm();
+    }
+    irq_enable(IRQ_TIMER);
+    irq_restore(s);
+}
+
+/* Run every expired timer; returns 0 if the service is not in use */
+int timer_service_isr(void) {
+    if (service_mode < 0)
+        return 0;
+
+    unsigned int s = irq_save();
+    unsigned long long now = get_cycles64();
+
+    while (heap_count > 0 && heap[0]->deadline <= now) {
+        struct soft_timer *t = heap[0];
+        heap_remove(t);
+
+        if (t->period != 0) {
+            /* Periodic: advance from the old deadline to avoid drift */
+            t->deadline += t->period;
+            if (t->deadline <= now)
+                t->deadline = now + t->period;
+            heap_place(t, heap_count++);
+            heap_sift_up(t->heap_index);
+        }
+
+        /* Callbacks may start or cancel timers, including this one */
+        irq_restore(s);
+        t->callback(t, t->ctx);
+        s = irq_save();
+        now = get_cycles64();
+    }
+
+    hw_timer_rearm();
+    irq_restore(s);
+    return 1;
+}
+
+int timer_service_mode(void) {
+    return service_mode;
+}
+
+/* ===== Timers ===== */
+
+void soft_timer_init(struct soft_timer *t, soft_timer_fn callback, void *ctx) {
+    t->deadline = 0;
+    t->period = 0;
+    t->callback = callback;
+    t->ctx = ctx;
+    t->heap_index = -1;
+}
+
+int soft_timer_start_cycles(struct soft_timer *t, unsigned long long delay,
+                            unsigned long long period) {
+    int result = 0;
+    unsigned int s = irq_save();
+
+    if (t->heap_index >= 0)
+        heap_remove(t);
+
+    if (heap_count < TIMER_MAX) {
+        t->deadline = get_cycles64() + delay;
+        t->period = period;
+        heap_place(t, heap_count++);
+        heap_sift_up(t->heap_index);
+        if (heap[0] == t)
+            hw_timer_rearm();
+    } else {
+        result = -1;
+    }
+
+    irq_restore(s);
+    return result;
+}
+
+int soft_timer_start(struct soft_timer *t, unsigned int delay_us, unsigned int period_us) {
+    return soft_timer_start_cycles(t, us_to_cycles(delay_us), us_to_cycles(period_us));
+}
+
+void soft_timer_cancel(struct soft_timer *t) {
+    unsigned int s = irq_save();
+    if (t->heap_index >= 0) {
+        int was_first = (t->heap_index == 0);
+        heap_remove(t);
+        if (was_first)
+            hw_timer_rearm();
+    }
+    irq_restore(s);
+}
+
+int soft_timer_active(const struct soft_timer *t) {
+    return t->heap_index >= 0;
+}
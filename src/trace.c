@@ -0,0 +1,86 @@
+#include "trace.h"
+#include "dtekv-lib.h"
+#include "atomic.h"
+#include "utils.h"
+
+#if TRACE_MAX_RECORDS & (TRACE_MAX_RECORDS - 1)
+#error "TRACE_MAX_RECORDS must be a power of two"
+#endif
+
+#ifdef TRACE_ENABLE
+
+struct trace_record trace_ring[TRACE_MAX_RECORDS];
+unsigned int trace_head;
+volatile int trace_on = 1;
+
+/* ===== Control ===== */
+
+void trace_start(void) {
+    trace_on = 1;
+}
+
+void trace_stop(void) {
+    trace_on = 0;
+}
+
+void trace_clear(void) {
+    unsigned int s = irq_save();
+    trace_head = 0;
+    irq_restore(s);
+}
+
+unsigned int trace_count(void) {
+    unsigned int head = trace_head;
+    return head < TRACE_MAX_RECORDS ? head : TRACE_MAX_RECORDS;
+}
+
+/* ===== Dump ===== */
+
+void trace_dump(void) {
+    unsigned int header[4];
+    int was_on = trace_on;
+
+    /* The UART driver's own probes would overwrite what is being sent */
+    trace_on = 0;
+    unsigned int head = trace_head;
+    unsigned int count = trace_count();
+
+    header[0] = TRACE_MAGIC;
+    header[1] = CPU_CLOCK_HZ;
+    header[2] = count;
+    header[3] = head - count;
+    uart_write((const char *)header, sizeof(header));
+
+    /* Oldest first: from the oldest slot to the end of the ring, then the rest */
+    unsigned int first = (head - count) & (TRACE_MAX_RECORDS - 1);
+    unsigned int n = TRACE_MAX_RECORDS - first;
+    if (n > count)
+        n = count;
+    uart_write((const char *)&trace_ring[first], n * sizeof(struct trace_record));
+    uart_write((const char *)trace_ring, (count - n) * sizeof(struct trace_record));
+    uart_flush();
+    trace_on = was_on;
+}
+
+#else
+
+void trace_start(void) {
+}
+
+void trace_stop(void) {
+}
+
+void trace_clear(void) {
+}
+
+unsigned int trace_count(void) {
+    return 0;
+}
+
+void trace_dump(void) {
+    unsigned int header[4] = { TRACE_MAGIC, CPU_CLOCK_HZ, 0, 0 };
+    uart_write((const char *)header, sizeof(header));
+    uart_flush();
+}
+
+#endif
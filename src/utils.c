@@ -1,115 +1,321 @@
 #include "utils.h"
 #include "dtekv-lib.h"
-
-/* Memory addresses */
-#define TIMER_BASE  0x04000020
-#define SW_BASE     0x04000010
+#include "convert.h"
+#include "csr.h"
+#include "devices.h"
 
 /* ===== Printf Implementation ===== */
 
-/* Simple variable argument list handling */
-typedef char *va_list;
-#define va_start(ap, last) ((ap) = (char *)&(last) + sizeof(last))
-#define va_arg(ap, type) (*(type *)((ap) += sizeof(type), (ap) - sizeof(type)))
-#define va_end(ap) ((void)0)
+/*
+ * All formatting goes through one core that writes into a buffer. For
+ * vsnprintf() the buffer is the caller's and output is truncated; for
+ * printf() it is a stack buffer that is handed to uart_write() in bulk
+ * whenever it fills up and once at the end.
+ */
+struct fmt_out {
+    char *buf;
+    int size;                               /* Usable capacity of buf */
+    int pos;                                /* Characters currently in buf */
+    int total;                              /* Characters produced so far */
+    void (*flush)(const char *buf, int n);  /* Called when buf is full */
+};
+
+/* Format flags */
+#define FMT_LEFT  0x01  /* '-': left-justify */
+#define FMT_ZERO  0x02  /* '0': pad with zeros */
+#define FMT_PLUS  0x04  /* '+': always print sign */
+#define FMT_SPACE 0x08  /* ' ': space for positive sign */
+#define FMT_ALT   0x10  /* '#': 0x prefix for hex, leading 0 for octal */
+#define FMT_UPPER 0x20  /* Upper-case hex digits */
+#define FMT_PTR   0x40  /* %p: 0x prefix even for a null pointer */
+
+static void fmt_putc(struct fmt_out *out, char c) {
+    if (out->pos >= out->size) {
+        if (out->flush == 0) {
+            out->total++;       /* Truncated, but keep counting */
+            return;
+        }
+        out->flush(out->buf, out->pos);
+        out->pos = 0;
+    }
+    out->buf[out->pos++] = c;
+    out->total++;
+}
 
-void printf(const char *format, ...) {
-    va_list args;
-    va_start(args, format);
+static void fmt_pad(struct fmt_out *out, char c, int n) {
+    while (n-- > 0) {
+        fmt_putc(out, c);
+    }
+}
+
+static void fmt_number(struct fmt_out *out, unsigned long long value, int negative,
+                       unsigned int base, int flags, int width, int precision) {
+    char tmp[CONV_BUF_SIZE];
+    int len = 0;
+
+    /* Precision 0 with value 0 prints no digits at all */
+    if (value != 0 || precision != 0)
+        len = u64_to_base(value, base, tmp, flags & FMT_UPPER);
+    if (precision < 0) {
+        precision = 1;
+    } else {
+        flags &= ~FMT_ZERO;     /* Explicit precision disables zero padding */
+    }
+
+    int zeros = precision > len ? precision - len : 0;
+    /* '#' with octal: make sure the first digit is a 0 */
+    if ((flags & FMT_ALT) && base == 8 && zeros == 0 && (len == 0 || tmp[0] != '0'))
+        zeros = 1;
+    char sign = negative ? '-' : (flags & FMT_PLUS) ? '+' : (flags & FMT_SPACE) ? ' ' : 0;
+    int prefix = (flags & FMT_PTR) || ((flags & FMT_ALT) && base == 16 && value != 0);
+    int body = len + zeros + (sign != 0) + 2 * prefix;
+
+    if (flags & FMT_ZERO && !(flags & FMT_LEFT) && width > body) {
+        zeros += width - body;
+        body = width;
+    }
+    if (!(flags & FMT_LEFT))
+        fmt_pad(out, ' ', width - body);
+    if (sign)
+        fmt_putc(out, sign);
+    if (prefix) {
+        fmt_putc(out, '0');
+        fmt_putc(out, (flags & FMT_UPPER) ? 'X' : 'x');
+    }
+    fmt_pad(out, '0', zeros);
+    for (int i = 0; i < len; i++) {
+        fmt_putc(out, tmp[i]);
+    }
+    if (flags & FMT_LEFT)
+        fmt_pad(out, ' ', width - body);
+}
+
+static void fmt_string(struct fmt_out *out, const char *s, int flags, int width,
+                       int precision) {
+    int len = 0;
+    while (s[len] != '\0' && (precision < 0 || len < precision)) {
+        len++;
+    }
+    if (!(flags & FMT_LEFT))
+        fmt_pad(out, ' ', width - len);
+    for (int i = 0; i < len; i++) {
+        fmt_putc(out, s[i]);
+    }
+    if (flags & FMT_LEFT)
+        fmt_pad(out, ' ', width - len);
+}
 
+/*
+ * Supports %d %i %u %x %X %o %b %c %s %p %% with flags "-0+ #", width and
+ * precision (numbers or '*') and the length modifiers hh, h, l and ll.
+ */
+static void fmt_format(struct fmt_out *out, const char *format, va_list args) {
     while (*format) {
-        if (*format == '%') {
-            format++;
-            switch (*format) {
-            case 'd':
-            case 'i': {
-                int val = va_arg(args, int);
-                print_dec(val);
-                break;
-            }
-            case 'u': {
-                unsigned int val = va_arg(args, unsigned int);
-                print_udec(val);
-                break;
-            }
-            case 'x':
-            case 'X': {
-                unsigned int val = va_arg(args, unsigned int);
-                print_hex(val, 8);
-                break;
-            }
-            case 'p': {
-                void *ptr = va_arg(args, void *);
-                print("0x");
-                print_hex((unsigned int)ptr, 8);
-                break;
+        if (*format != '%') {
+            fmt_putc(out, *format++);
+            continue;
+        }
+        format++;
+
+        /* Flags */
+        int flags = 0;
+        for (;; format++) {
+            if (*format == '-')      flags |= FMT_LEFT;
+            else if (*format == '0') flags |= FMT_ZERO;
+            else if (*format == '+') flags |= FMT_PLUS;
+            else if (*format == ' ') flags |= FMT_SPACE;
+            else if (*format == '#') flags |= FMT_ALT;
+            else break;
+        }
+
+        /* Width */
+        int width = 0;
+        if (*format == '*') {
+            width = va_arg(args, int);
+            if (width < 0) {
+                flags |= FMT_LEFT;
+                width = -width;
             }
-            case 's': {
-                char *str = va_arg(args, char *);
-                print(str ? str : "(null)");
-                break;
+            format++;
+        } else {
+            while (*format >= '0' && *format <= '9') {
+                width = width * 10 + (*format++ - '0');
             }
-            case 'c': {
-                char ch = (char)va_arg(args, int);
-                printc(ch);
-                break;
+        }
+
+        /* Precision */
+        int precision = -1;
+        if (*format == '.') {
+            format++;
+            precision = 0;
+            if (*format == '*') {
+                precision = va_arg(args, int);
+                format++;
+            } else {
+                while (*format >= '0' && *format <= '9') {
+                    precision = precision * 10 + (*format++ - '0');
+                }
             }
-            case '%':
-                printc('%');
-                break;
-            default:
-                printc('%');
-                printc(*format);
-                break;
+        }
+
+        /* Length modifier: 'l' is 32 bits on RV32, 'll' is 64 bits, 'h'/'hh' narrow */
+        int is_long_long = 0;
+        int narrow = 0;         /* 1 = short, 2 = char */
+        while (*format == 'h' || *format == 'l') {
+            if (format[0] == 'l' && format[1] == 'l') {
+                is_long_long = 1;
+                format++;
+            } else if (format[0] == 'h') {
+                narrow++;
             }
-        } else {
-            printc(*format);
+            format++;
+        }
+
+        switch (*format) {
+        case 'd':
+        case 'i': {
+            long long val = is_long_long ? va_arg(args, long long) : va_arg(args, int);
+            if (narrow == 1)
+                val = (short)val;
+            else if (narrow >= 2)
+                val = (signed char)val;
+            unsigned long long mag = val < 0 ? 0ULL - (unsigned long long)val
+                                             : (unsigned long long)val;
+            fmt_number(out, mag, val < 0, 10, flags, width, precision);
+            break;
+        }
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'b': {
+            unsigned long long val = is_long_long ? va_arg(args, unsigned long long)
+                                                  : va_arg(args, unsigned int);
+            if (narrow == 1)
+                val = (unsigned short)val;
+            else if (narrow >= 2)
+                val = (unsigned char)val;
+            unsigned int base = 10;
+            if (*format == 'x' || *format == 'X')
+                base = 16;
+            else if (*format == 'o')
+                base = 8;
+            else if (*format == 'b')
+                base = 2;
+            if (*format == 'X')
+                flags |= FMT_UPPER;
+            fmt_number(out, val, 0, base, flags & ~(FMT_PLUS | FMT_SPACE), width,
+                       precision);
+            break;
+        }
+        case 'p': {
+            void *ptr = va_arg(args, void *);
+            fmt_number(out, (unsigned long)ptr, 0, 16, FMT_PTR | (flags & FMT_LEFT), width, 8);
+            break;
+        }
+        case 's': {
+            const char *str = va_arg(args, const char *);
+            fmt_string(out, str ? str : "(null)", flags, width, precision);
+            break;
+        }
+        case 'c': {
+            char ch = (char)va_arg(args, int);
+            if (!(flags & FMT_LEFT))
+                fmt_pad(out, ' ', width - 1);
+            fmt_putc(out, ch);
+            if (flags & FMT_LEFT)
+                fmt_pad(out, ' ', width - 1);
+            break;
+        }
+        case '%':
+            fmt_putc(out, '%');
+            break;
+        case '\0':
+            return;
+        default:
+            fmt_putc(out, '%');
+            fmt_putc(out, *format);
+            break;
         }
         format++;
     }
+}
+
+int vsnprintf(char *buf, int size, const char *format, va_list args) {
+    struct fmt_out out;
+    out.buf = buf;
+    out.size = size > 0 ? size - 1 : 0;     /* Reserve room for the NUL */
+    out.pos = 0;
+    out.total = 0;
+    out.flush = 0;
+
+    fmt_format(&out, format, args);
+    if (size > 0)
+        buf[out.pos] = '\0';
+    return out.total;   /* Length the full output would have had */
+}
 
+int snprintf(char *buf, int size, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, size, format, args);
+    va_end(args);
+    return n;
+}
+
+void vprintf(const char *format, va_list args) {
+    char buf[PRINTF_BUF_SIZE];
+    struct fmt_out out;
+    out.buf = buf;
+    out.size = PRINTF_BUF_SIZE;
+    out.pos = 0;
+    out.total = 0;
+    out.flush = uart_write;
+
+    fmt_format(&out, format, args);
+    uart_write(buf, out.pos);
+}
+
+void printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
     va_end(args);
 }
 
 /* ===== Memory Dump Utilities ===== */
 
 void mem_dump(unsigned int address, unsigned int length) {
-    volatile unsigned char *ptr = (volatile unsigned char *)address;
-
     printf("Memory dump at 0x%x (%u bytes):\n", address, length);
 
     for (unsigned int i = 0; i < length; i++) {
         if (i % 16 == 0) {
             printf("\n0x%x: ", address + i);
         }
-        printf("%x ", ptr[i]);
+        printf("%02x ", mmio_read8(address + i));
     }
     printf("\n");
 }
 
 void mem_dump_words(unsigned int address, unsigned int num_words) {
-    volatile unsigned int *ptr = (volatile unsigned int *)address;
-
     printf("Memory dump at 0x%x (%u words):\n", address, num_words);
 
     for (unsigned int i = 0; i < num_words; i++) {
         if (i % 4 == 0) {
             printf("\n0x%x: ", address + (i * 4));
         }
-        printf("0x%x ", ptr[i]);
+        printf("0x%08x ", mmio_read32(address + i * 4));
     }
     printf("\n");
 }
 
 void mem_write(unsigned int address, unsigned int value) {
-    volatile unsigned int *ptr = (volatile unsigned int *)address;
-    *ptr = value;
+    mmio_write32(address, value);
     printf("Wrote 0x%x to address 0x%x\n", value, address);
 }
 
 unsigned int mem_read(unsigned int address) {
-    volatile unsigned int *ptr = (volatile unsigned int *)address;
-    unsigned int value = *ptr;
+    unsigned int value = mmio_read32(address);
     printf("Read 0x%x from address 0x%x\n", value, address);
     return value;
 }
@@ -117,54 +323,44 @@ unsigned int mem_read(unsigned int address) {
 /* ===== Register Inspection ===== */
 
 void reg_dump_csr(void) {
-    unsigned int mstatus, mie, mip, mcause, mepc, mcycle, minstret;
-
-    /* Read CSRs using inline assembly */
-    asm volatile("csrr %0, mstatus" : "=r"(mstatus));
-    asm volatile("csrr %0, mie" : "=r"(mie));
-    asm volatile("csrr %0, mip" : "=r"(mip));
-    asm volatile("csrr %0, mcause" : "=r"(mcause));
-    asm volatile("csrr %0, mepc" : "=r"(mepc));
-    asm volatile("csrr %0, mcycle" : "=r"(mcycle));
-    asm volatile("csrr %0, minstret" : "=r"(minstret));
+    unsigned int mstatus = csr_read(mstatus);
+    unsigned int mie = csr_read(mie);
+    unsigned int mip = csr_read(mip);
+    unsigned int mcause = csr_read(mcause);
+    unsigned int mepc = csr_read(mepc);
+    unsigned int mcycle = csr_read(mcycle);
+    unsigned int minstret = csr_read(minstret);
 
     printf("\n=== RISC-V CSR Dump ===\n");
-    printf("mstatus:  0x%x\n", mstatus);
-    printf("mie:      0x%x\n", mie);
-    printf("mip:      0x%x\n", mip);
-    printf("mcause:   0x%x\n", mcause);
-    printf("mepc:     0x%x\n", mepc);
+    printf("mstatus:  0x%08x\n", mstatus);
+    printf("mie:      0x%08x\n", mie);
+    printf("mip:      0x%08x\n", mip);
+    printf("mcause:   0x%08x\n", mcause);
+    printf("mepc:     0x%08x\n", mepc);
     printf("mcycle:   %u\n", mcycle);
     printf("minstret: %u\n", minstret);
 }
 
 void reg_dump_timer(void) {
-    volatile unsigned short *status = (volatile unsigned short *)(TIMER_BASE + 0x00);
-    volatile unsigned short *control = (volatile unsigned short *)(TIMER_BASE + 0x04);
-    volatile unsigned short *periodl = (volatile unsigned short *)(TIMER_BASE + 0x08);
-    volatile unsigned short *periodh = (volatile unsigned short *)(TIMER_BASE + 0x0C);
+    unsigned int periodl = mmio_read16(TIMER_PERIODL);
+    unsigned int periodh = mmio_read16(TIMER_PERIODH);
 
     printf("\n=== Timer Registers ===\n");
-    printf("STATUS:  0x%x\n", *status);
-    printf("CONTROL: 0x%x\n", *control);
-    printf("PERIODL: 0x%x\n", *periodl);
-    printf("PERIODH: 0x%x\n", *periodh);
+    printf("STATUS:  0x%x\n", mmio_read16(TIMER_STATUS));
+    printf("CONTROL: 0x%x\n", mmio_read16(TIMER_CONTROL));
+    printf("PERIODL: 0x%x\n", periodl);
+    printf("PERIODH: 0x%x\n", periodh);
 
-    unsigned int period = (*periodh << 16) | *periodl;
+    unsigned int period = (periodh << 16) | periodl;
     printf("Period:  %u cycles\n", period);
 }
 
 void reg_dump_switches(void) {
-    volatile unsigned int *sw_data = (volatile unsigned int *)(SW_BASE + 0x00);
-    volatile unsigned int *sw_dir = (volatile unsigned int *)(SW_BASE + 0x04);
-    volatile unsigned int *sw_mask = (volatile unsigned int *)(SW_BASE + 0x08);
-    volatile unsigned int *sw_edge = (volatile unsigned int *)(SW_BASE + 0x0C);
-
     printf("\n=== Switch Registers ===\n");
-    printf("DATA:         0x%x\n", *sw_data);
-    printf("DIRECTION:    0x%x\n", *sw_dir);
-    printf("IRQ_MASK:     0x%x\n", *sw_mask);
-    printf("EDGE_CAPTURE: 0x%x\n", *sw_edge);
+    printf("DATA:         0x%x\n", mmio_read32(SW_DATA));
+    printf("DIRECTION:    0x%x\n", mmio_read32(SW_DIRECTION));
+    printf("IRQ_MASK:     0x%x\n", mmio_read32(SW_IRQ_MASK));
+    printf("EDGE_CAPTURE: 0x%x\n", mmio_read32(SW_EDGE_CAPTURE));
 }
 
 void reg_dump_all(void) {
@@ -177,117 +373,89 @@ void reg_dump_all(void) {
 /* ===== String Formatting Helpers ===== */
 
 void itoa(int value, char *str, int base) {
-    char *ptr = str;
-    char *ptr1 = str;
-    char tmp_char;
-    int tmp_value;
-
-    if (base < 2 || base > 36) {
-        *str = '\0';
-        return;
-    }
-
-    do {
-        tmp_value = value;
-        value /= base;
-        *ptr++ = "0123456789abcdefghijklmnopqrstuvwxyz"[tmp_value - value * base];
-    } while (value);
-
-    if (tmp_value < 0) *ptr++ = '-';
-    *ptr-- = '\0';
-
-    /* Reverse string */
-    while (ptr1 < ptr) {
-        tmp_char = *ptr;
-        *ptr-- = *ptr1;
-        *ptr1++ = tmp_char;
+    if (base == 10) {
+        i32_to_dec(value, str);
+    } else {
+        u64_to_base((unsigned int)value, base, str, 0);
     }
 }
 
 void utoa(unsigned int value, char *str, int base) {
-    char *ptr = str;
-    char *ptr1 = str;
-    char tmp_char;
-    unsigned int tmp_value;
-
-    if (base < 2 || base > 36) {
-        *str = '\0';
-        return;
-    }
-
-    do {
-        tmp_value = value;
-        value /= base;
-        *ptr++ = "0123456789abcdefghijklmnopqrstuvwxyz"[tmp_value - value * base];
-    } while (value);
-
-    *ptr-- = '\0';
-
-    /* Reverse string */
-    while (ptr1 < ptr) {
-        tmp_char = *ptr;
-        *ptr-- = *ptr1;
-        *ptr1++ = tmp_char;
-    }
+    u64_to_base(value, base, str, 0);
 }
 
 /* ===== Timing Utilities ===== */
 
+/*
+ * Conversions avoid division: units = (cycles * M) >> 64 with
+ * M = floor(2^64 * units_per_second / CPU_CLOCK_HZ), folded at compile
+ * time. Results are exact or at most one unit low.
+ */
+#define SCALE_MULT(units) \
+    ((~0ULL / CPU_CLOCK_HZ) * (units) + \
+     ((~0ULL % CPU_CLOCK_HZ + 1) * (units)) / CPU_CLOCK_HZ)
+#define CYCLES_TO_US_MULT SCALE_MULT(1000000ULL)
+#define CYCLES_TO_MS_MULT SCALE_MULT(1000ULL)
+
+/* Cycles per microsecond in 16.16 fixed point */
+#define US_TO_CYCLES_Q16 (((unsigned long long)CPU_CLOCK_HZ << 16) / 1000000)
+
 unsigned int get_cycles(void) {
-    unsigned int cycles;
-    asm volatile("csrr %0, mcycle" : "=r"(cycles));
-    return cycles;
+    return csr_read(mcycle);
 }
 
-unsigned int get_time_ms(void) {
-    /* Assuming 30 MHz clock */
-    return get_cycles() / 30000;
+/* Re-read mcycleh so a carry out of mcycle between the reads is seen */
+unsigned long long get_cycles64(void) {
+    unsigned int hi, lo, hi2;
+    do {
+        hi = csr_read(mcycleh);
+        lo = csr_read(mcycle);
+        hi2 = csr_read(mcycleh);
+    } while (hi != hi2);
+    return ((unsigned long long)hi << 32) | lo;
 }
 
-void sleep_ms(unsigned int ms) {
-    unsigned int target = get_time_ms() + ms;
-    while (get_time_ms() < target);
+unsigned long long cycles_to_us(unsigned long long cycles) {
+    return mulhi64(cycles, CYCLES_TO_US_MULT);
 }
 
-/* ===== String Utilities ===== */
+unsigned long long cycles_to_ms(unsigned long long cycles) {
+    return mulhi64(cycles, CYCLES_TO_MS_MULT);
+}
 
-/* String length */
-int strlen(const char *s) {
-    int len = 0;
-    while (s[len] != '\0') {
-        len++;
-    }
-    return len;
+unsigned long long us_to_cycles(unsigned long long us) {
+    unsigned int hi = (unsigned int)(us >> 32);
+    unsigned int lo = (unsigned int)us;
+    return (((unsigned long long)hi * US_TO_CYCLES_Q16) << 16) +
+           (((unsigned long long)lo * US_TO_CYCLES_Q16) >> 16);
 }
 
-/* String comparison */
-int strcmp(const char *s1, const char *s2) {
-    while (*s1 && (*s1 == *s2)) {
-        s1++;
-        s2++;
-    }
-    return *(unsigned char *)s1 - *(unsigned char *)s2;
+unsigned long long get_time_us(void) {
+    return cycles_to_us(get_cycles64());
 }
 
-/* String copy */
-void strcpy(char *dest, const char *src) {
-    while (*src != '\0') {
-        *dest = *src;
-        dest++;
-        src++;
-    }
-    *dest = '\0';
+unsigned int get_time_ms(void) {
+    return (unsigned int)cycles_to_ms(get_cycles64());
 }
 
-/* String concatenation */
-void strcat(char *dest, const char *src) {
-    while (*dest != '\0') {
-        dest++;
-    }
-    while (*src != '\0') {
-        *dest = *src;
-        dest++;
-        src++;
+/* Busy-wait by comparing elapsed cycles, immune to counter wraparound */
+void sleep_cycles(unsigned long long cycles) {
+    if (cycles < 0x80000000u) {
+        unsigned int start = get_cycles();
+        unsigned int n = (unsigned int)cycles;
+        while (get_cycles() - start < n)
+            ;
+    } else {
+        unsigned long long start = get_cycles64();
+        while (get_cycles64() - start < cycles)
+            ;
     }
-    *dest = '\0';
+}
+
+void sleep_us(unsigned int us) {
+    sleep_cycles(us_to_cycles(us));
+}
+
+void sleep_ms(unsigned int ms) {
+    sleep_cycles(us_to_cycles((unsigned long long)ms * 1000));
 }
@@ -0,0 +1,37 @@
+#ifndef TEST_H
+#define TEST_H
+
+/*
+ * DTEK-V Host Tests
+ * Built with `make host-test` against the device model in host/sim.c
+ *
+ * A test is a void function run by test_run(). CHECK() failures are
+ * recorded and reported once the test returns, so a check can sit inside
+ * a sim_uart_capture() window without its message being captured; the
+ * runner also puts the shared device and driver state back afterwards.
+ */
+
+/* Record a failed condition; the test carries on */
+#define CHECK(cond) test_check((cond) != 0, __FILE__, __LINE__, #cond, 0, 0, 0)
+
+/* As CHECK(), reporting both values when they differ */
+#define CHECK_EQ(actual, expected) \
+    test_check((actual) == (expected), __FILE__, __LINE__, #actual " == " #expected, \
+               1, (unsigned int)(actual), (unsigned int)(expected))
+
+void test_check(int ok, const char *file, int line, const char *expr,
+                int has_values, unsigned int actual, unsigned int expected);
+
+/* Run one test and report PASS or its first failed check */
+void test_run(const char *name, void (*fn)(void));
+
+/* Spin until *flag is nonzero or cycles pass; returns the flag */
+int test_wait(volatile int *flag, unsigned int cycles);
+
+/* Test groups */
+void test_sim(void);
+void test_uart(void);      /* Transmit policies, see uart_set_tx_policy() */
+void test_irq(void);       /* Priorities and nesting, see irq.h */
+void test_format(void);    /* printf() conversions */
+
+#endif /* TEST_H */
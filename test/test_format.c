@@ -0,0 +1,44 @@
+#include "test.h"
+#include "utils.h"
+#include "strmem.h"
+
+static char buf[64];
+
+static int formats(const char *want, int n) {
+    return n == (int)strlen(want) && strcmp(buf, want) == 0;
+}
+
+static void test_format_pointer(void) {
+    CHECK(formats("0x00000000", snprintf(buf, sizeof(buf), "%p", (void *)0)));
+    CHECK(formats("0x0000beef", snprintf(buf, sizeof(buf), "%p", (void *)0xBEEF)));
+    CHECK(formats("  0x00000010", snprintf(buf, sizeof(buf), "%12p", (void *)0x10)));
+    CHECK(formats("0x00000010  |", snprintf(buf, sizeof(buf), "%-12p|", (void *)0x10)));
+
+    /* '#' still leaves zero unprefixed, as in C */
+    CHECK(formats("0 0x1f", snprintf(buf, sizeof(buf), "%#x %#x", 0, 0x1F)));
+}
+
+static void test_format_alt_octal(void) {
+    CHECK(formats("017", snprintf(buf, sizeof(buf), "%#o", 15)));
+    CHECK(formats("0", snprintf(buf, sizeof(buf), "%#o", 0)));
+    CHECK(formats("0", snprintf(buf, sizeof(buf), "%#.0o", 0)));
+    CHECK(formats("00017", snprintf(buf, sizeof(buf), "%#.5o", 15)));
+    CHECK(formats("  017", snprintf(buf, sizeof(buf), "%#5o", 15)));
+    CHECK(formats("17", snprintf(buf, sizeof(buf), "%o", 15)));
+}
+
+/* h and hh convert the promoted int back to short and char, as in C */
+static void test_format_length(void) {
+    CHECK(formats("ff", snprintf(buf, sizeof(buf), "%hhx", 0x1FF)));
+    CHECK(formats("-32768", snprintf(buf, sizeof(buf), "%hd", 0x18000)));
+    CHECK(formats("-1 255", snprintf(buf, sizeof(buf), "%hhd %hhu", 0xFF, 0xFF)));
+    CHECK(formats("65535", snprintf(buf, sizeof(buf), "%hu", -1)));
+    CHECK(formats("4294967296", snprintf(buf, sizeof(buf), "%llu", 1ULL << 32)));
+}
+
+void test_format(void) {
+    printf("\nFormatting:\n");
+    test_run("format_pointer", test_format_pointer);
+    test_run("format_length", test_format_length);
+    test_run("format_alt_octal", test_format_alt_octal);
+}
@@ -0,0 +1,99 @@
+#include "test.h"
+#include "dtekv-lib.h"
+#include "devices.h"
+#include "irq.h"
+#include "csr.h"
+#include "utils.h"
+#include "sim.h"
+
+static volatile int in_switch;
+static volatile int button_calls;
+static int button_nested;       /* The button handler ran inside the switch's */
+
+static void on_button(unsigned int state) {
+    button_calls++;
+    if (in_switch)
+        button_nested = 1;
+}
+
+/* A button press arrives while the switch handler runs */
+static void on_switch(unsigned int state) {
+    in_switch = 1;
+    sim_button_set(1);
+    in_switch = 0;
+}
+
+static void inputs_on(int button_priority) {
+    in_switch = 0;
+    button_calls = 0;
+    button_nested = 0;
+    switch_isr = on_switch;
+    button_isr = on_button;
+    irq_register(IRQ_BUTTON, handle_button_irq, 0, button_priority);
+    mmio_write32(SW_IRQ_MASK, 0x3FF);
+    mmio_write32(BTN_IRQ_MASK, 0x1);
+}
+
+static void inputs_off(void) {
+    mmio_write32(SW_IRQ_MASK, 0);
+    mmio_write32(BTN_IRQ_MASK, 0);
+    sim_button_set(0);
+    sim_switch_set(0);
+    irq_register(IRQ_BUTTON, handle_button_irq, 0, IRQ_PRIO_NORMAL);
+}
+
+/* Sources enabled by enable_interrupt() rather than irq_enable() nest too */
+static void test_irq_nest_enable_interrupt(void) {
+    inputs_on(IRQ_PRIO_HIGH);
+    enable_interrupt();
+
+    sim_switch_set(0x1);
+    CHECK_EQ(button_calls, 1);
+    CHECK_EQ(button_nested, 1);
+    CHECK_EQ(irq_nesting, 0);
+    inputs_off();
+}
+
+/* Equal priority: the press waits until the switch handler returns */
+static void test_irq_no_nest_same_priority(void) {
+    inputs_on(IRQ_PRIO_NORMAL);
+    enable_interrupt();
+
+    sim_switch_set(0x1);
+    CHECK_EQ(button_calls, 0);
+    sim_poll();                         /* The next instruction after mret */
+    CHECK_EQ(button_calls, 1);
+    CHECK_EQ(button_nested, 0);
+    inputs_off();
+}
+
+/* A nested handler's own irq_enable() and irq_disable() survive its return */
+static int held_seen;
+
+static void on_switch_toggle(unsigned int state) {
+    held_seen = irq_is_enabled(IRQ_SWITCHES) && irq_is_enabled(IRQ_TIMER);
+    irq_disable(IRQ_SWITCHES);
+    irq_enable(IRQ_JTAG_UART);
+}
+
+static void test_irq_nested_enable_disable(void) {
+    inputs_on(IRQ_PRIO_HIGH);
+    switch_isr = on_switch_toggle;
+    held_seen = 0;
+    enable_interrupt();
+
+    sim_switch_set(0x1);
+    CHECK_EQ(held_seen, 1);             /* Masked for nesting, still enabled */
+    CHECK_EQ(irq_is_enabled(IRQ_SWITCHES), 0);
+    CHECK_EQ(irq_is_enabled(IRQ_JTAG_UART), 1);
+    CHECK_EQ(irq_is_enabled(IRQ_TIMER), 1);
+    CHECK_EQ(irq_is_enabled(IRQ_BUTTON), 1);
+    inputs_off();
+}
+
+void test_irq(void) {
+    printf("\nInterrupt dispatch:\n");
+    test_run("irq_nest_enable_interrupt", test_irq_nest_enable_interrupt);
+    test_run("irq_no_nest_same_priority", test_irq_no_nest_same_priority);
+    test_run("irq_nested_enable_disable", test_irq_nested_enable_disable);
+}
@@ -0,0 +1,92 @@
+#include "test.h"
+#include "dtekv-lib.h"
+#include "devices.h"
+#include "irq.h"
+#include "csr.h"
+#include "utils.h"
+#include "sim.h"
+
+static struct {
+    int failures;               /* Failed checks in the running test */
+    const char *file;           /* The first of them */
+    int line;
+    const char *expr;
+    int has_values;
+    unsigned int actual, expected;
+} current;
+
+static int passed, failed;
+
+void test_check(int ok, const char *file, int line, const char *expr,
+                int has_values, unsigned int actual, unsigned int expected) {
+    if (ok || current.failures++)
+        return;
+    current.file = file;
+    current.line = line;
+    current.expr = expr;
+    current.has_values = has_values;
+    current.actual = actual;
+    current.expected = expected;
+}
+
+int test_wait(volatile int *flag, unsigned int cycles) {
+    unsigned long long end = sim_cycles() + cycles;
+    while (!*flag && sim_cycles() < end)
+        sim_poll();
+    return *flag;
+}
+
+/* Interrupts, ISR hooks and device settings back to their start-up state */
+static void test_reset(void) {
+    csr_clear(mstatus, MSTATUS_MIE);
+    uart_flush();
+    sim_uart_set_drain(0);
+    sim_uart_capture(0, 0);
+    uart_set_tx_policy(UART_TX_BLOCK);
+
+    for (unsigned int cause = 0; cause < IRQ_MAX; cause++)
+        irq_disable(cause);
+    timer_isr = 0;
+    switch_isr = 0;
+    button_isr = 0;
+
+    mmio_write16(TIMER_CONTROL, TIMER_CTRL_STOP);
+    mmio_write16(TIMER_STATUS, 0);
+    mmio_write32(SW_IRQ_MASK, 0);
+    mmio_write32(SW_EDGE_CAPTURE, ~0u);
+    mmio_write32(BTN_IRQ_MASK, 0);
+    mmio_write32(BTN_EDGE_CAPTURE, ~0u);
+}
+
+void test_run(const char *name, void (*fn)(void)) {
+    current.failures = 0;
+    fn();
+    test_reset();
+
+    if (current.failures == 0) {
+        passed++;
+        printf("  PASS %s\n", name);
+        return;
+    }
+    failed++;
+    printf("  FAIL %s\n    %s:%d: %s", name, current.file, current.line, current.expr);
+    if (current.has_values)
+        printf(" (got %u, expected %u)", current.actual, current.expected);
+    if (current.failures > 1)
+        printf(", %d more failed", current.failures - 1);
+    printf("\n");
+}
+
+int main(void) {
+    printf("\n=== DTEK-V Host Tests ===\n");
+    test_reset();
+
+    test_sim();
+    test_uart();
+    test_irq();
+    test_format();
+
+    printf("\n=== %d passed, %d failed ===\n", passed, failed);
+    uart_flush();
+    return failed != 0;
+}
@@ -0,0 +1,215 @@
+#include "test.h"
+#include "dtekv-lib.h"
+#include "devices.h"
+#include "irq.h"
+#include "csr.h"
+#include "utils.h"
+#include "strmem.h"
+#include "sim.h"
+
+#define SLOW_DRAIN 1000         /* Cycles per byte, about 33 us at 30 MHz */
+
+static char out[256];
+
+/* ===== JTAG UART ===== */
+
+static unsigned int wspace(void) {
+    return mmio_read32(JTAG_UART_CTRL) >> 16;
+}
+
+static void test_uart_drain(void) {
+    static const char msg[] = "fifo drain";
+    unsigned int n = sizeof(msg) - 1;
+
+    sim_uart_set_drain(SLOW_DRAIN);
+    sim_uart_capture(out, sizeof(out));
+    for (unsigned int i = 0; i < n; i++)
+        mmio_write32(JTAG_UART_DATA, msg[i]);
+
+    unsigned int level = sim_uart_tx_level();
+    CHECK(level > 0 && level <= n);
+    CHECK_EQ(wspace(), SIM_UART_FIFO - sim_uart_tx_level());
+
+    unsigned long long end = sim_cycles() + (unsigned long long)(n + 2) * SLOW_DRAIN * 4;
+    while (sim_uart_tx_level() && sim_cycles() < end)
+        ;
+    CHECK_EQ(sim_uart_tx_level(), 0);
+    CHECK_EQ(wspace(), SIM_UART_FIFO);
+    CHECK_EQ(sim_uart_captured(), n);
+    CHECK(memcmp(out, msg, n) == 0);
+}
+
+/* Writes to a full FIFO are lost; a drain rate of 0 empties it at once */
+static void test_uart_fifo_full(void) {
+    sim_uart_set_drain(SLOW_DRAIN * 1000);
+    sim_uart_capture(out, sizeof(out));
+    for (unsigned int i = 0; i < SIM_UART_FIFO + 8; i++)
+        mmio_write32(JTAG_UART_DATA, 'a' + i % 26);
+
+    CHECK_EQ(sim_uart_tx_level(), SIM_UART_FIFO);
+    CHECK_EQ(wspace(), 0);
+    CHECK_EQ(sim_uart_captured(), 0);
+
+    sim_uart_set_drain(0);
+    CHECK_EQ(sim_uart_tx_level(), 0);
+    CHECK_EQ(sim_uart_captured(), SIM_UART_FIFO);
+    CHECK_EQ(out[SIM_UART_FIFO - 1], 'a' + (SIM_UART_FIFO - 1) % 26);
+}
+
+/* ===== Timer ===== */
+
+#define TIMER_TEST_PERIOD 3000  /* 100 us */
+
+static volatile int timer_fired;
+static unsigned long long timer_fired_at;
+
+static void on_timer(void) {
+    if (timer_fired++ == 0)
+        timer_fired_at = sim_cycles();
+}
+
+static void timer_arm(unsigned int period, unsigned int control) {
+    mmio_write16(TIMER_PERIODL, period & 0xFFFF);
+    mmio_write16(TIMER_PERIODH, period >> 16);
+    timer_fired = 0;
+    timer_isr = on_timer;
+    irq_enable(IRQ_TIMER);
+    csr_set(mstatus, MSTATUS_MIE);
+    mmio_write16(TIMER_CONTROL, TIMER_CTRL_ITO | TIMER_CTRL_START | control);
+}
+
+static void test_timer_oneshot(void) {
+    unsigned long long start = sim_cycles();
+    timer_arm(TIMER_TEST_PERIOD, 0);
+
+    CHECK(test_wait(&timer_fired, TIMER_TEST_PERIOD * 1000));
+    CHECK(timer_fired_at - start >= TIMER_TEST_PERIOD);
+    CHECK_EQ(mmio_read16(TIMER_STATUS) & TIMER_STATUS_RUN, 0);
+
+    /* One-shot: nothing more once it has expired */
+    unsigned long long end = sim_cycles() + TIMER_TEST_PERIOD * 5;
+    while (sim_cycles() < end)
+        sim_poll();
+    CHECK_EQ(timer_fired, 1);
+}
+
+static void test_timer_continuous(void) {
+    timer_arm(TIMER_TEST_PERIOD, TIMER_CTRL_CONT);
+
+    unsigned long long end = sim_cycles() + TIMER_TEST_PERIOD * 1000;
+    while (timer_fired < 3 && sim_cycles() < end)
+        sim_poll();
+    CHECK(timer_fired >= 3);
+    CHECK(mmio_read16(TIMER_STATUS) & TIMER_STATUS_RUN);
+
+    mmio_write16(TIMER_CONTROL, TIMER_CTRL_STOP);
+    CHECK_EQ(mmio_read16(TIMER_STATUS) & TIMER_STATUS_RUN, 0);
+}
+
+/* ===== Switches and Button ===== */
+
+static volatile int input_calls;
+static unsigned int input_state;
+
+static void on_input(unsigned int state) {
+    input_calls++;
+    input_state = state;
+}
+
+static void test_switch_edges(void) {
+    input_calls = 0;
+    switch_isr = on_input;
+    mmio_write32(SW_IRQ_MASK, 0x3FF);
+    irq_enable(IRQ_SWITCHES);
+    csr_set(mstatus, MSTATUS_MIE);
+
+    sim_switch_set(0x5);
+    CHECK_EQ(input_calls, 1);
+    CHECK_EQ(input_state, 0x5);
+    CHECK_EQ(mmio_read32(SW_EDGE_CAPTURE), 0);
+
+    /* No change, no edge; turning one off is an edge too */
+    sim_switch_set(0x5);
+    CHECK_EQ(input_calls, 1);
+    sim_switch_set(0x1);
+    CHECK_EQ(input_calls, 2);
+    CHECK_EQ(input_state, 0x1);
+
+    /* Masked: the edge is captured but raises nothing */
+    mmio_write32(SW_IRQ_MASK, 0);
+    sim_switch_set(0x3);
+    CHECK_EQ(input_calls, 2);
+    CHECK_EQ(mmio_read32(SW_EDGE_CAPTURE), 0x2);
+    CHECK_EQ(mmio_read32(SW_DATA), 0x3);
+
+    mmio_write32(SW_IRQ_MASK, 0x3FF);   /* The held edge fires once unmasked */
+    CHECK_EQ(input_calls, 3);
+    sim_switch_set(0);
+}
+
+static void test_button_edges(void) {
+    input_calls = 0;
+    button_isr = on_input;
+    mmio_write32(BTN_IRQ_MASK, 0x1);
+    irq_enable(IRQ_BUTTON);
+    csr_set(mstatus, MSTATUS_MIE);
+
+    sim_button_set(1);
+    CHECK_EQ(input_calls, 1);
+    CHECK_EQ(input_state, 1);
+
+    /* Only presses latch */
+    sim_button_set(0);
+    CHECK_EQ(input_calls, 1);
+    CHECK_EQ(mmio_read32(BTN_EDGE_CAPTURE), 0);
+    CHECK_EQ(mmio_read32(BTN_DATA), 0);
+
+    sim_button_set(1);
+    sim_button_set(0);
+    CHECK_EQ(input_calls, 2);
+}
+
+/* ===== GPIO ===== */
+
+static void test_gpio_banks(void) {
+    gpio_init();
+    CHECK_EQ(sim_gpio_direction(0), 0);
+    CHECK_EQ(sim_gpio_direction(1), 0);
+
+    /* Bank 0 through the port calls: low nibble out, the rest in */
+    gpio_port_set_direction(0, 0xFF, 0x0F);
+    CHECK_EQ(sim_gpio_direction(0), 0x0F);
+    gpio_port_write(0, 0xFF, 0xA5);
+    CHECK_EQ(sim_gpio_output(0), 0x05);
+    sim_gpio_set_input(0, 0xF0, 0x30);
+    CHECK_EQ(gpio_port_read(0) & 0xFF, 0x35);
+
+    /* Bank 1 through pin numbers; nothing leaks into bank 0 */
+    gpio_set_direction(25, 1);
+    gpio_write(25, 1);
+    CHECK_EQ(sim_gpio_direction(1), GPIO_PIN_MASK(25));
+    CHECK_EQ(sim_gpio_output(1), GPIO_PIN_MASK(25));
+    CHECK_EQ(sim_gpio_direction(0), 0x0F);
+    gpio_toggle(25);
+    CHECK_EQ(sim_gpio_output(1), 0);
+
+    sim_gpio_set_input(1, GPIO_BANK_MASK, GPIO_PIN_MASK(39));
+    CHECK_EQ(gpio_read(39), 1);
+    CHECK_EQ(gpio_read(25), 0);
+    CHECK_EQ(gpio_read(19), 0);
+
+    sim_gpio_set_input(0, GPIO_BANK_MASK, 0);
+    sim_gpio_set_input(1, GPIO_BANK_MASK, 0);
+    gpio_init();
+}
+
+void test_sim(void) {
+    printf("\nDevice model:\n");
+    test_run("uart_drain", test_uart_drain);
+    test_run("uart_fifo_full", test_uart_fifo_full);
+    test_run("timer_oneshot", test_timer_oneshot);
+    test_run("timer_continuous", test_timer_continuous);
+    test_run("switch_edges", test_switch_edges);
+    test_run("button_edges", test_button_edges);
+    test_run("gpio_banks", test_gpio_banks);
+}
@@ -0,0 +1,104 @@
+#include "test.h"
+#include "dtekv-lib.h"
+#include "utils.h"
+#include "sim.h"
+
+/* The link is slower than the CPU, so the transmit ring fills up */
+#define SLOW_DRAIN  300         /* Cycles per byte, 10 us at 30 MHz */
+#define OVERFLOW    100         /* Bytes written beyond the ring's size */
+#define LONG_WRITE  (UART_TX_BUF_SIZE * 3)
+
+static char data[LONG_WRITE];
+static char out[LONG_WRITE + 64];
+
+/* A pattern whose every byte tells its position, modulo 251 */
+static void fill(unsigned int n) {
+    for (unsigned int i = 0; i < n; i++)
+        data[i] = (char)(i % 251);
+}
+
+static unsigned int first_mismatch(const char *got, const char *want, unsigned int n) {
+    for (unsigned int i = 0; i < n; i++) {
+        if (got[i] != want[i])
+            return i;
+    }
+    return n;
+}
+
+static void slow_link(int policy) {
+    uart_set_tx_policy(policy);
+    sim_uart_set_drain(SLOW_DRAIN);
+    sim_uart_capture(out, sizeof(out));
+}
+
+/* uart_flush() returns once the ring is in the FIFO; wait for the link too */
+static void flush_link(void) {
+    uart_flush();
+    while (sim_uart_tx_level())
+        ;
+}
+
+/* Full ring: the new bytes are lost and counted, the queued ones go out */
+static void test_uart_drop(void) {
+    struct uart_stats before, after;
+    unsigned int n = UART_TX_BUF_SIZE + OVERFLOW;
+
+    fill(n);
+    uart_get_stats(&before);
+    slow_link(UART_TX_DROP);
+    uart_write(data, n);
+    flush_link();
+    uart_get_stats(&after);
+
+    CHECK_EQ(after.tx_dropped - before.tx_dropped, OVERFLOW);
+    CHECK_EQ(after.tx_overwritten, before.tx_overwritten);
+    CHECK_EQ(after.tx_high_water, UART_TX_BUF_SIZE);
+    CHECK_EQ(sim_uart_captured(), UART_TX_BUF_SIZE);
+    CHECK_EQ(first_mismatch(out, data, UART_TX_BUF_SIZE), UART_TX_BUF_SIZE);
+}
+
+/* Full ring: the oldest queued bytes make way, so the last ones go out */
+static void test_uart_overwrite(void) {
+    struct uart_stats before, after;
+    unsigned int n = UART_TX_BUF_SIZE + OVERFLOW;
+
+    fill(n);
+    uart_get_stats(&before);
+    slow_link(UART_TX_OVERWRITE);
+    uart_write(data, n);
+    flush_link();
+    uart_get_stats(&after);
+
+    CHECK_EQ(after.tx_overwritten - before.tx_overwritten, OVERFLOW);
+    CHECK_EQ(after.tx_dropped, before.tx_dropped);
+    CHECK_EQ(after.tx_high_water, UART_TX_BUF_SIZE);
+    CHECK_EQ(sim_uart_captured(), UART_TX_BUF_SIZE);
+    CHECK_EQ(first_mismatch(out, data + OVERFLOW, UART_TX_BUF_SIZE), UART_TX_BUF_SIZE);
+}
+
+/* Full ring: the writer waits for the link, and every byte arrives in order */
+static void test_uart_block(void) {
+    struct uart_stats before, after;
+
+    fill(LONG_WRITE);
+    uart_get_stats(&before);
+    slow_link(UART_TX_BLOCK);
+    uart_write(data, LONG_WRITE);
+    CHECK(uart_tx_pending() > 0);       /* Returns before the tail is sent */
+    flush_link();
+    uart_get_stats(&after);
+
+    CHECK_EQ(uart_tx_pending(), 0);
+    CHECK_EQ(after.tx_dropped, before.tx_dropped);
+    CHECK_EQ(after.tx_overwritten, before.tx_overwritten);
+    CHECK_EQ(after.tx_high_water, UART_TX_BUF_SIZE);
+    CHECK_EQ(sim_uart_captured(), LONG_WRITE);
+    CHECK_EQ(first_mismatch(out, data, LONG_WRITE), LONG_WRITE);
+}
+
+void test_uart(void) {
+    printf("\nUART transmit policies:\n");
+    test_run("uart_drop", test_uart_drop);
+    test_run("uart_overwrite", test_uart_overwrite);
+    test_run("uart_block", test_uart_block);
+}